@@ -0,0 +1,463 @@
+#include "async_io.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define JSONTOXML_HAVE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+static string systemError(const string& what, const string& path, int err) {
+    return "Error: Cannot " + what + " '" + path + "': " + strerror(err);
+}
+
+// Blocking forms, for the thread pool.
+static bool readWhole(const string& path, string& data, string& error) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = systemError("open", path, errno);
+        return false;
+    }
+    struct stat st;
+    size_t size = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? size_t(st.st_size) : 0;
+    // room past the size, so the read that finds the end does not move the data
+    data.reserve(size + 64 * 1024);
+    data.resize(size);
+    size_t done = 0;
+    for (;;) {
+        // not a regular file, or one that grew: keep reading until read() says the end
+        if (done == data.size()) data.resize(done + 64 * 1024);
+        ssize_t n = ::read(fd, &data[done], data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            error = systemError("read", path, errno);
+            close(fd);
+            return false;
+        }
+        if (n == 0) break;
+        done += size_t(n);
+    }
+    data.resize(done);
+    close(fd);
+    return true;
+#else
+    ifstream in(path, ios::binary);
+    if (!in) {
+        error = "Error: Cannot open '" + path + "'";
+        return false;
+    }
+    stringstream buffer;
+    buffer << in.rdbuf();
+    data = buffer.str();
+    return true;
+#endif
+}
+
+static bool writeWhole(const string& path, const string& data, string& error) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = systemError("create", path, errno);
+        return false;
+    }
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            error = systemError("write", path, errno);
+            close(fd);
+            return false;
+        }
+        done += size_t(n);
+    }
+    if (close(fd) != 0) {
+        error = systemError("write", path, errno);
+        return false;
+    }
+    return true;
+#else
+    ofstream out(path, ios::binary);
+    out.write(data.data(), data.size());
+    out.close();
+    if (!out) {
+        error = "Error: Cannot write '" + path + "'";
+        return false;
+    }
+    return true;
+#endif
+}
+
+namespace {
+// A pool of threads making the blocking calls.
+class ThreadIoQueue : public IoQueue {
+public:
+    explicit ThreadIoQueue(size_t count) {
+        for (size_t i = 0; i < count; i++) threads.emplace_back([this] { run(); });
+    }
+    ~ThreadIoQueue() override {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        task_ready.notify_all();
+        for (thread& t : threads) t.join();
+    }
+
+    const char* name() const override { return "threads"; }
+    void read(size_t id, const string& path) override { push({READ, id, path, string()}); }
+    void write(size_t id, const string& path, string data) override { push({WRITE, id, path, move(data)}); }
+    void note(size_t id) override {
+        {
+            lock_guard<mutex> guard(lock);
+            done.push_back({id, NOTE, true, string(), string()});
+        }
+        done_ready.notify_one();
+    }
+    void wait(vector<Completion>& completions) override {
+        unique_lock<mutex> guard(lock);
+        done_ready.wait(guard, [this] { return !done.empty(); });
+        for (Completion& c : done) completions.push_back(move(c));
+        done.clear();
+    }
+
+private:
+    struct Task {
+        Kind kind;
+        size_t id;
+        string path;
+        string data;
+    };
+    void push(Task task) {
+        {
+            lock_guard<mutex> guard(lock);
+            tasks.push_back(move(task));
+        }
+        task_ready.notify_one();
+    }
+    void run() {
+        for (;;) {
+            Task task;
+            {
+                unique_lock<mutex> guard(lock);
+                task_ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = move(tasks.front());
+                tasks.pop_front();
+            }
+            Completion c{task.id, task.kind, false, string(), string()};
+            c.ok = task.kind == READ ? readWhole(task.path, c.data, c.error) : writeWhole(task.path, task.data, c.error);
+            {
+                lock_guard<mutex> guard(lock);
+                done.push_back(move(c));
+            }
+            done_ready.notify_one();
+        }
+    }
+
+    mutex lock;
+    condition_variable task_ready, done_ready;
+    deque<Task> tasks;
+    deque<Completion> done;
+    bool stopping = false;
+    vector<thread> threads;
+};
+
+#ifdef JSONTOXML_HAVE_URING
+// io_uring through the raw system calls. Each request is a small state
+// machine (open, then reads or writes until done, then close) whose next
+// step is queued from the completion of the one before. Requests made on
+// the waiting thread go out with its next io_uring_enter; requests from
+// other threads are submitted at once, which also wakes the waiter.
+class UringIoQueue : public IoQueue {
+public:
+    ~UringIoQueue() override {
+        vector<Completion> ignored;
+        while (outstanding) wait(ignored);
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_size);
+        if (sq_ring) munmap(sq_ring, sq_size);
+        if (ring >= 0) close(ring);
+    }
+
+    bool setup(size_t depth, string& error) {
+        unsigned entries = 8;
+        while (entries < depth + 16 && entries < 4096) entries *= 2;
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ring = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring < 0) {
+            error = string("Error: io_uring is unavailable: ") + strerror(errno);
+            return false;
+        }
+        if (!supported(error)) return false;
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sq_size = cq_size = max(sq_size, cq_size);
+        sq_ring = map(sq_size, IORING_OFF_SQ_RING);
+        cq_ring = single ? sq_ring : map(cq_size, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)map(sqes_size, IORING_OFF_SQES);
+        if (!sq_ring || !cq_ring || !sqes) {
+            error = string("Error: Cannot map the io_uring rings: ") + strerror(errno);
+            return false;
+        }
+        char* sq = (char*)sq_ring;
+        char* cq = (char*)cq_ring;
+        sq_tail = (unsigned*)(sq + params.sq_off.tail);
+        sq_head = (unsigned*)(sq + params.sq_off.head);
+        sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        sq_array = (unsigned*)(sq + params.sq_off.array);
+        cq_head = (unsigned*)(cq + params.cq_off.head);
+        cq_tail = (unsigned*)(cq + params.cq_off.tail);
+        cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    const char* name() const override { return "io_uring"; }
+    void read(size_t id, const string& path) override {
+        Op* op = new Op(READ, id, path);
+        prepare(op, IORING_OP_OPENAT);
+    }
+    void write(size_t id, const string& path, string data) override {
+        Op* op = new Op(WRITE, id, path, move(data));
+        prepare(op, IORING_OP_OPENAT);
+    }
+    void note(size_t id) override {
+        Op* op = new Op(NOTE, id, string());
+        prepare(op, IORING_OP_NOP);
+    }
+
+    void wait(vector<Completion>& completions) override {
+        {
+            lock_guard<mutex> guard(lock);
+            waiter = this_thread::get_id();
+        }
+        size_t before = completions.size();
+        while (completions.size() == before) {
+            unsigned submit = take_pending();
+            if (syscall(__NR_io_uring_enter, ring, submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+                lock_guard<mutex> guard(lock);
+                pending += submit; // try again next round
+            }
+            unsigned head = *cq_head;
+            unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            // Ops queued by other threads were filled in under the lock before
+            // their submission; taking it orders those writes before the reads
+            // below in a way tools such as ThreadSanitizer can see.
+            { lock_guard<mutex> guard(lock); }
+            for (; head != tail; head++) {
+                const io_uring_cqe& cqe = cqes[head & cq_mask];
+                advance((Op*)(uintptr_t)cqe.user_data, cqe.res, completions);
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        }
+        // next steps queued above go out without waiting for the next call
+        if (unsigned submit = take_pending()) syscall(__NR_io_uring_enter, ring, submit, 0, 0, nullptr, 0);
+    }
+
+private:
+    enum Step { OPEN, TRANSFER, CLOSE, DONE };
+    struct Op {
+        Op(Kind kind, size_t id, string path, string data = string())
+            : kind(kind), id(id), path(move(path)), data(move(data)) {}
+        Kind kind;
+        size_t id;
+        string path;
+        string data;
+        int fd = -1;
+        size_t done = 0;
+        bool stream = false; // read from a pipe or the like, which has no offsets
+        Step step = OPEN;
+        string error;
+    };
+
+    bool supported(string& error) {
+        size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        vector<char> buffer(size, 0);
+        io_uring_probe* probe = (io_uring_probe*)buffer.data();
+        if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            error = "Error: io_uring cannot be probed (kernel too old)";
+            return false;
+        }
+        for (int op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE, IORING_OP_NOP}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                error = "Error: io_uring lacks file operations this needs (kernel too old)";
+                return false;
+            }
+        }
+        return true;
+    }
+    void* map(size_t size, off_t offset) {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+    unsigned take_pending() {
+        lock_guard<mutex> guard(lock);
+        unsigned n = pending;
+        pending = 0;
+        return n;
+    }
+
+    // Queues the next step of `op`.
+    void prepare(Op* op, int opcode) {
+        bool now;
+        {
+            lock_guard<mutex> guard(lock);
+            now = this_thread::get_id() != waiter;
+            if (opcode == IORING_OP_OPENAT || opcode == IORING_OP_NOP) outstanding++; // a new request
+            unsigned tail = *sq_tail;
+            for (unsigned queued; (queued = tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE)) >= sq_entries;) {
+                // full: hand the kernel what is queued so it frees slots
+                syscall(__NR_io_uring_enter, ring, queued, 0, 0, nullptr, 0);
+                pending = 0;
+            }
+            unsigned index = tail & sq_mask;
+            io_uring_sqe& sqe = sqes[index];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = uint8_t(opcode);
+            sqe.user_data = (uint64_t)(uintptr_t)op;
+            switch (opcode) {
+            case IORING_OP_OPENAT:
+                sqe.fd = AT_FDCWD;
+                sqe.addr = (uint64_t)(uintptr_t)op->path.c_str();
+                sqe.open_flags = op->kind == READ ? O_RDONLY | O_CLOEXEC : O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                sqe.len = 0644;
+                break;
+            case IORING_OP_READ:
+            case IORING_OP_WRITE:
+                sqe.fd = op->fd;
+                sqe.addr = (uint64_t)(uintptr_t)(op->data.data() + op->done);
+                sqe.len = unsigned(min(op->data.size() - op->done, size_t(1) << 30));
+                sqe.off = op->stream ? uint64_t(-1) : op->done; // -1: at the current position
+                break;
+            case IORING_OP_CLOSE:
+                sqe.fd = op->fd;
+                break;
+            }
+            sq_array[index] = index;
+            __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+            if (!now) pending++;
+        }
+        if (now) syscall(__NR_io_uring_enter, ring, 1, 0, 0, nullptr, 0);
+    }
+
+    // A read ends only at a read that returns 0, as in readWhole: the stat
+    // size is 0 for a pipe and out of date for a file that grew.
+    void transfer_or_close(Op* op) {
+        if (op->kind == READ && op->done == op->data.size()) op->data.resize(op->done + 64 * 1024);
+        if (op->done < op->data.size()) {
+            op->step = TRANSFER;
+            prepare(op, op->kind == READ ? IORING_OP_READ : IORING_OP_WRITE);
+        } else {
+            op->step = CLOSE;
+            prepare(op, IORING_OP_CLOSE);
+        }
+    }
+
+    void advance(Op* op, int res, vector<Completion>& completions) {
+        if (op->kind == NOTE) {
+            op->step = DONE;
+        } else if (op->step == OPEN) {
+            if (res < 0) {
+                op->error = systemError(op->kind == READ ? "open" : "create", op->path, -res);
+                op->step = DONE;
+            } else {
+                op->fd = res;
+                struct stat st;
+                if (op->kind == READ) {
+                    bool regular = fstat(op->fd, &st) == 0 && S_ISREG(st.st_mode);
+                    size_t size = regular ? size_t(st.st_size) : 0;
+                    op->stream = !regular;
+                    op->data.reserve(size + 64 * 1024);
+                    op->data.resize(size);
+                }
+                transfer_or_close(op);
+            }
+        } else if (op->step == TRANSFER) {
+            if (res == -EINTR || res == -EAGAIN) {
+                transfer_or_close(op);
+            } else if (res <= 0) {
+                // an error, or a read that met the end
+                if (res < 0) op->error = systemError(op->kind == READ ? "read" : "write", op->path, -res);
+                else if (op->kind == READ) op->data.resize(op->done);
+                else op->error = systemError("write", op->path, EIO);
+                op->step = CLOSE;
+                prepare(op, IORING_OP_CLOSE);
+            } else {
+                op->done += size_t(res);
+                transfer_or_close(op);
+            }
+        } else if (op->step == CLOSE) {
+            if (res < 0 && op->error.empty()) op->error = systemError("close", op->path, -res);
+            op->step = DONE;
+        }
+        if (op->step != DONE) return;
+        Completion c{op->id, op->kind, op->error.empty(), op->error, string()};
+        if (op->kind == READ && c.ok) c.data = move(op->data);
+        completions.push_back(move(c));
+        delete op;
+        lock_guard<mutex> guard(lock);
+        outstanding--;
+    }
+
+    int ring = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    size_t sq_size = 0, cq_size = 0, sqes_size = 0;
+    unsigned *sq_head = nullptr, *sq_tail = nullptr, *sq_array = nullptr;
+    unsigned sq_mask = 0, sq_entries = 0;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    mutex lock; // the submission queue and the counters below
+    unsigned pending = 0;
+    size_t outstanding = 0;
+    thread::id waiter;
+};
+#endif
+}
+
+unique_ptr<IoQueue> makeIoQueue(IoBackend backend, size_t depth, string& error) {
+#ifdef JSONTOXML_HAVE_URING
+    if (backend != IoBackend::THREADS) {
+        unique_ptr<UringIoQueue> uring(new UringIoQueue);
+        if (uring->setup(depth, error)) return uring;
+        if (backend == IoBackend::URING) return nullptr;
+    }
+#else
+    if (backend == IoBackend::URING) {
+        error = "Error: io_uring support is not compiled in";
+        return nullptr;
+    }
+#endif
+    // blocking calls mostly wait on the device, so more threads than cores help
+    size_t threads = min<size_t>(max<size_t>(depth, 1), 64);
+    return unique_ptr<IoQueue>(new ThreadIoQueue(threads));
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef JSONTOXML_ASYNC_IO_H
+#define JSONTOXML_ASYNC_IO_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jsontoxml {
+
+// Whole-file reads and writes that run in the background and are collected
+// with wait(). Requests carry a caller-chosen id that comes back with their
+// completion. read(), write() and note() may be called from any thread;
+// wait() only from one.
+class IoQueue {
+public:
+    enum Kind { READ, WRITE, NOTE };
+    struct Completion {
+        size_t id;
+        Kind kind;
+        bool ok;
+        std::string error; // when !ok
+        std::string data;  // file contents, for a READ
+    };
+
+    virtual ~IoQueue() = default;
+    virtual const char* name() const = 0;
+    // Opens, reads and closes `path`.
+    virtual void read(size_t id, const std::string& path) = 0;
+    // Creates or truncates `path`, writes `data` to it and closes it.
+    virtual void write(size_t id, const std::string& path, std::string data) = 0;
+    // Completes at once with kind NOTE; lets other threads wake the waiter.
+    virtual void note(size_t id) = 0;
+    // Blocks until at least one request has completed and appends all the
+    // completions that are ready.
+    virtual void wait(std::vector<Completion>& completions) = 0;
+};
+
+enum class IoBackend { AUTO, URING, THREADS };
+
+// `depth` is the most requests the caller will have outstanding at once.
+// AUTO picks io_uring when the kernel supports the operations it needs and
+// otherwise a pool of threads making blocking calls. Returns nullptr, with
+// `error` set, only when URING is asked for and unavailable.
+std::unique_ptr<IoQueue> makeIoQueue(IoBackend backend, size_t depth, std::string& error);
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+#include "batch.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+using namespace std;
+
+namespace jsontoxml {
+
+bool convertBatch(const Options& options, const vector<string>& inputs, const BatchOptions& batch,
+                  BatchResult& result, string& error) {
+    result = BatchResult();
+    size_t depth = max<size_t>(batch.queue_depth, 1);
+    size_t workerCount = batch.workers ? batch.workers : max(1u, thread::hardware_concurrency());
+
+    vector<string> outputs;
+    map<string, size_t> claimed;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        string output = (filesystem::path(batch.output_dir) / filesystem::path(inputs[i]).stem()).string() + ".xml";
+        auto [it, added] = claimed.emplace(output, i);
+        if (!added) {
+            error = "Error: '" + inputs[it->second] + "' and '" + inputs[i] + "' would both be written to '" + output + "'";
+            return false;
+        }
+        outputs.push_back(output);
+    }
+    error_code ec;
+    filesystem::create_directories(batch.output_dir, ec);
+    if (ec) {
+        error = "Error: Cannot create '" + batch.output_dir + "': " + ec.message();
+        return false;
+    }
+
+    Options workerOptions = options;
+    workerOptions.stats = nullptr;
+    workerOptions.index = nullptr;
+    workerOptions.diagnostics = nullptr;
+    // built up front so a bad token or grammar file stops the batch before any I/O
+    vector<unique_ptr<Context>> contexts;
+    for (size_t i = 0; i < workerCount; i++) {
+        contexts.emplace_back(new Context(workerOptions));
+        if (!contexts.back()->ok()) {
+            error = contexts.back()->error();
+            return false;
+        }
+    }
+    unique_ptr<IoQueue> io = makeIoQueue(batch.backend, depth, error);
+    if (!io) return false;
+    result.backend = io->name();
+
+    // files read and waiting for a converter
+    struct Job {
+        size_t id;
+        string data;
+    };
+    mutex lock;
+    condition_variable ready;
+    deque<Job> jobs;
+    bool closing = false;
+    mutex report; // keeps each file's messages together on cerr
+    atomic<uint64_t> bytesOut{0};
+
+    auto work = [&](Context& context) {
+        for (;;) {
+            Job job;
+            {
+                unique_lock<mutex> guard(lock);
+                ready.wait(guard, [&] { return closing || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = move(jobs.front());
+                jobs.pop_front();
+            }
+            StringSink sink;
+            if (context.convert(job.data.data(), job.data.size(), sink)) {
+                bytesOut += sink.str.size();
+                io->write(job.id, outputs[job.id], move(sink.str));
+                continue;
+            }
+            Diagnostics diagnostics(options.diagnostics ? options.diagnostics->limit : 0);
+            if (options.diagnostics) context.diagnose(job.data.data(), job.data.size(), diagnostics);
+            {
+                lock_guard<mutex> guard(report);
+                if (diagnostics.list.empty()) cerr << inputs[job.id] << ": " << context.error() << endl;
+                for (const Diagnostic& diagnostic : diagnostics.list) {
+                    cerr << inputs[job.id] << ": " << formatDiagnostic(diagnostic) << endl;
+                }
+            }
+            io->note(job.id); // frees the file's slot
+        }
+    };
+    vector<thread> workers;
+    for (size_t i = 0; i < workerCount; i++) workers.emplace_back(work, ref(*contexts[i]));
+
+    size_t next = 0, held = 0, finished = 0;
+    vector<IoQueue::Completion> completions;
+    while (finished < inputs.size()) {
+        for (; held < depth && next < inputs.size(); held++, next++) io->read(next, inputs[next]);
+        completions.clear();
+        io->wait(completions);
+        for (IoQueue::Completion& c : completions) {
+            if (c.kind == IoQueue::READ && c.ok) {
+                result.bytes_in += c.data.size();
+                {
+                    lock_guard<mutex> guard(lock);
+                    jobs.push_back({c.id, move(c.data)});
+                }
+                ready.notify_one();
+                continue;
+            }
+            if (!c.ok) {
+                lock_guard<mutex> guard(report);
+                cerr << c.error << endl;
+                result.failed++;
+            } else if (c.kind == IoQueue::WRITE) {
+                result.converted++;
+            } else {
+                result.rejected++;
+            }
+            held--;
+            finished++;
+        }
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        closing = true;
+    }
+    ready.notify_all();
+    for (thread& t : workers) t.join();
+    result.bytes_out = bytesOut;
+    return true;
+}
+
+}
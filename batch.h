@@ -0,0 +1,46 @@
+#ifndef JSONTOXML_BATCH_H
+#define JSONTOXML_BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "async_io.h"
+#include "jsontoxml.h"
+
+namespace jsontoxml {
+
+struct BatchOptions {
+    // Each input is written to <output_dir>/<its name without extension>.xml.
+    std::string output_dir;
+    // The most files held at once, from the read being issued until their
+    // XML is written; bounds both the I/O in flight and the memory used.
+    size_t queue_depth = 64;
+    // Converter threads; 0 picks one per core.
+    size_t workers = 0;
+    IoBackend backend = IoBackend::AUTO;
+};
+
+struct BatchResult {
+    size_t converted = 0;
+    size_t rejected = 0;
+    size_t failed = 0; // could not be read or written
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    std::string backend;
+};
+
+// Converts many files with the reads and writes overlapped with conversion:
+// the calling thread keeps up to queue_depth reads queued on an IoQueue,
+// hands each file it gets back to a pool of converter threads, each with its
+// own Context, and they queue the XML to be written the same way. Rejected
+// files are reported on cerr, with every error found when
+// options.diagnostics is set. options.stats and options.index do not apply
+// and are ignored; a cache is shared by the workers. Returns false, with
+// `error` set, only when the batch cannot start.
+bool convertBatch(const Options& options, const std::vector<std::string>& inputs, const BatchOptions& batch,
+                  BatchResult& result, std::string& error);
+
+}
+
+#endif
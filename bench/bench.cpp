@@ -0,0 +1,463 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "codegen.h"
+#include "converter.h"
+#include "corpus.h"
+#include "grammar.h"
+#include "iovec_sink.h"
+#include "jsontoxml.h"
+#include "memory.h"
+#include "parser.h"
+#include "rd_parser.h"
+#include "rule_table.h"
+#include "scanner.h"
+#include "shape.h"
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+using namespace jsontoxml;
+
+// allocation counters
+static atomic<size_t> allocCount{0}, allocBytes{0};
+
+// Every replaceable form is given, so each allocation is counted and
+// released by its matching function (GCC warns of a mismatch otherwise).
+static void* counted(size_t size, size_t alignment = 0) {
+    allocCount.fetch_add(1, memory_order_relaxed);
+    allocBytes.fetch_add(size, memory_order_relaxed);
+    if (!size) size = 1;
+    void* p = alignment ? aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : malloc(size);
+    if (p) return p;
+    throw bad_alloc();
+}
+void* operator new(size_t size) { return counted(size); }
+void* operator new[](size_t size) { return counted(size); }
+void* operator new(size_t size, align_val_t alignment) { return counted(size, size_t(alignment)); }
+void* operator new[](size_t size, align_val_t alignment) { return counted(size, size_t(alignment)); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, align_val_t) noexcept { free(p); }
+void operator delete[](void* p, align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { free(p); }
+
+struct Result {
+    string shape;
+    size_t size;
+    string stage;
+    bool ok;
+    size_t iterations;
+    double seconds;
+    double mbPerSec;
+    double docsPerSec;
+    double allocsPerDoc;
+    double allocBytesPerDoc;
+};
+
+static double minTime = 0.2;
+
+// Runs `body` until minTime has passed (at least once after a warm-up run).
+template <typename F>
+Result measure(const string& shape, const string& stage, size_t bytes, F body) {
+    bool ok = body();
+    size_t iterations = 0;
+    size_t allocs0 = allocCount.load(), allocBytes0 = allocBytes.load();
+    auto start = chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        ok = body() && ok;
+        iterations++;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < minTime);
+    size_t allocs = allocCount.load() - allocs0, allocated = allocBytes.load() - allocBytes0;
+
+    Result r;
+    r.shape = shape;
+    r.size = bytes;
+    r.stage = stage;
+    r.ok = ok;
+    r.iterations = iterations;
+    r.seconds = elapsed;
+    r.mbPerSec = bytes * iterations / elapsed / (1024.0 * 1024.0);
+    r.docsPerSec = iterations / elapsed;
+    r.allocsPerDoc = (double)allocs / iterations;
+    r.allocBytesPerDoc = (double)allocated / iterations;
+    return r;
+}
+
+string toJson(const Result& r) {
+    ostringstream s;
+    s << "{\"shape\":\"" << r.shape << "\",\"size\":" << r.size << ",\"stage\":\"" << r.stage
+      << "\",\"ok\":" << (r.ok ? "true" : "false") << ",\"iterations\":" << r.iterations
+      << ",\"seconds\":" << r.seconds << ",\"mb_per_s\":" << r.mbPerSec
+      << ",\"docs_per_s\":" << r.docsPerSec << ",\"allocs_per_doc\":" << r.allocsPerDoc
+      << ",\"alloc_bytes_per_doc\":" << r.allocBytesPerDoc << "}";
+    return s.str();
+}
+
+// Results files hold one result object per line, so a baseline can be read back
+// with plain string searches.
+string field(const string& line, const string& name) {
+    size_t pos = line.find("\"" + name + "\":");
+    if (pos == string::npos) return "";
+    pos += name.size() + 3;
+    if (line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        return line.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = line.find_first_of(",}", pos);
+    return line.substr(pos, end - pos);
+}
+
+size_t parseSize(const string& s) {
+    size_t n = strtoull(s.c_str(), nullptr, 10);
+    switch (s.empty() ? 0 : s.back()) {
+        case 'K': case 'k': return n << 10;
+        case 'M': case 'm': return n << 20;
+        case 'G': case 'g': return n << 30;
+    }
+    return n;
+}
+
+vector<string> splitList(const string& s) {
+    vector<string> out;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ',')) out.push_back(item);
+    return out;
+}
+
+// Hardware cache misses of this thread while counting, or -1 when perf
+// events are not available (other platforms, containers, perf_event_paranoid).
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    long long stop() {
+#ifdef __linux__
+        long long count;
+        if (fd >= 0 && ioctl(fd, PERF_EVENT_IOC_DISABLE, 0) == 0 && read(fd, &count, sizeof(count)) == sizeof(count))
+            return count;
+#endif
+        return -1;
+    }
+
+private:
+    int fd = -1;
+};
+
+// Lookups in a synthetic LL(1) table of the given size, dense against comb
+// packed: each row has a few lookaheads of its own plus one rule that
+// covers a run of them, like an expression nonterminal, and the lookups
+// follow the valid cells with an occasional miss, as a parse would.
+static volatile long long lookupSink;
+static volatile int lookupZero = 0;
+
+int ruleTableBench(size_t rows, size_t columns) {
+    mt19937 rnd(1);
+    vector<RuleEntry> entries;
+    int rule = 0;
+    for (size_t r = 0; r < rows; r++) {
+        set<size_t> taken;
+        size_t own = 1 + rnd() % 6;
+        for (size_t i = 0; i < own; i++) taken.insert(rnd() % columns);
+        for (size_t c : taken) entries.push_back({int(r), int(c), rule++});
+        if (rnd() % 3 == 0) {
+            size_t start = rnd() % columns, run = 2 + rnd() % 40;
+            int shared = rule++;
+            for (size_t c = start; c < min(columns, start + run); c++)
+                if (!taken.count(c)) entries.push_back({int(r), int(c), shared});
+        }
+    }
+    vector<pair<int, int>> probes(1 << 20);
+    for (auto& probe : probes) {
+        if (rnd() % 16 == 0) probe = {int(rnd() % rows), int(rnd() % columns)};
+        else {
+            const RuleEntry& e = entries[rnd() % entries.size()];
+            probe = {e.row, e.column};
+        }
+    }
+
+    RuleTable tables[2];
+    tables[0].build(rows, columns, entries, RuleTable::DENSE);
+    tables[1].build(rows, columns, entries, RuleTable::COMB);
+    for (const RuleEntry& e : entries) {
+        if (tables[0].lookup(e.row, e.column) != e.rule || tables[1].lookup(e.row, e.column) != e.rule) {
+            cerr << "Error: Layouts disagree at (" << e.row << "," << e.column << ")" << endl;
+            return 1;
+        }
+    }
+    cout << rows << "x" << columns << " table, " << entries.size() << " entries" << endl;
+    CacheMissCounter misses;
+    for (int i = 0; i < 2; i++) {
+        const RuleTable& table = tables[i];
+        // Each lookup waits for the one before it, as the parser's next
+        // lookup waits for the rule it just expanded; `zero` keeps the
+        // compiler from seeing through the dependency.
+        int zero = lookupZero;
+        long long sum = 0;
+        int last = 0;
+        for (const auto& probe : probes) sum += last = table.lookup(probe.first + (last & zero), probe.second);
+        size_t rounds = 0;
+        misses.start();
+        auto start = chrono::steady_clock::now();
+        double elapsed;
+        do {
+            for (const auto& probe : probes) sum += last = table.lookup(probe.first + (last & zero), probe.second);
+            rounds++;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < minTime);
+        long long missCount = misses.stop();
+        double lookups = double(rounds) * probes.size();
+        cout << (i ? "comb " : "dense") << "\t" << table.bytes() / 1024 << " KB\t"
+             << elapsed / lookups * 1e9 << " ns/lookup\t";
+        if (missCount >= 0) cout << missCount / lookups << " cache misses/lookup";
+        else cout << "cache misses n/a";
+        cout << endl;
+        lookupSink = sum;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> sizes = {"1K", "64K", "1M"};
+    vector<string> shapes = corpusShapes();
+    string outFile = "bench_results.json", baselineFile, tokensFile = "tokens.txt", grammarFile = "grammar.txt";
+    double threshold = 10;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto next = [&]() { return i + 1 < argc ? string(argv[++i]) : string(); };
+        if (arg == "--sizes") sizes = splitList(next());
+        else if (arg == "--shapes") shapes = splitList(next());
+        else if (arg == "--min-time") minTime = atof(next().c_str());
+        else if (arg == "--out") outFile = next();
+        else if (arg == "--baseline") baselineFile = next();
+        else if (arg == "--threshold") threshold = atof(next().c_str());
+        else if (arg == "--tokens") tokensFile = next();
+        else if (arg == "--grammar") grammarFile = next();
+        else if (arg == "--generate") {
+            string shape = next();
+            string doc = generateCorpus(shape, parseSize(next()));
+            cout << doc;
+            return 0;
+        } else if (arg == "--rule-table") {
+            // --rule-table ROWSxCOLUMNS
+            string dims = next();
+            size_t x = dims.find('x');
+            if (x == string::npos) {
+                cerr << "Error: --rule-table wants ROWSxCOLUMNS" << endl;
+                return 2;
+            }
+            return ruleTableBench(parseSize(dims.substr(0, x)), parseSize(dims.substr(x + 1)));
+        } else {
+            cerr << "usage: bench [--sizes 1K,64K,1M] [--shapes wide,deep,...] [--min-time sec]\n"
+                    "             [--out results.json] [--baseline old.json] [--threshold percent]\n"
+                    "             [--tokens tokens.txt] [--grammar grammar.txt]\n"
+                    "       bench --generate <shape> <size>\n"
+                    "       bench --rule-table <rows>x<columns>" << endl;
+            return 2;
+        }
+    }
+
+    vector<TokenRule> rules = loadTokenRules(tokensFile);
+    Grammar grammar;
+    bool loaded = !rules.empty() && readGrammar(grammarFile, grammar);
+    LL1_parser parser;
+    // the generated parser is only comparable when built from the same grammar
+    bool rdMatches = false;
+    if (loaded) {
+        SymbolSets firstSets = computeFirst(grammar);
+        SymbolSets followSets = computeFollow(grammar, firstSets);
+        ParsingTable table(grammar, firstSets, followSets);
+        table.build_parsing_table();
+        parser = LL1_parser(table.get_grammar(), table.get_table());
+        rdMatches = grammarSignature(grammar.startsymbol, table.get_table()) == rdGrammarSignature;
+    }
+    Options options;
+    options.tokens_file = tokensFile;
+    options.grammar_file = grammarFile;
+    Context context(options);
+    if (!loaded || !parser.is_loaded() || !context.ok()) {
+        cerr << "Error: Cannot load " << tokensFile << " / " << grammarFile << endl;
+        return 1;
+    }
+
+    vector<Result> results;
+    bool failed = false;
+#ifdef __linux__
+    int devNull = open("/dev/null", O_WRONLY);
+#endif
+    for (const string& shape : shapes) {
+        for (const string& sizeName : sizes) {
+            string doc = generateCorpus(shape, parseSize(sizeName));
+            if (doc.empty()) {
+                cerr << "Error: Unknown shape " << shape << endl;
+                failed = true;
+                break;
+            }
+            TokenList tokens;
+            string error;
+            // a rejected document only times how fast the error is found
+            if (!scanInput(doc.data(), doc.size(), rules, tokens, error) || !parser.check_parser(tokens)) {
+                cerr << "Error: The " << shape << " " << sizeName << " corpus is rejected by " << tokensFile
+                     << " / " << grammarFile << endl;
+                failed = true;
+                continue;
+            }
+
+            size_t first = results.size();
+            results.push_back(measure(shape, "scan", doc.size(), [&]() {
+                TokenList t;
+                string e;
+                return scanInput(doc.data(), doc.size(), rules, t, e);
+            }));
+            results.push_back(measure(shape, "validate", doc.size(), [&]() {
+                return parser.check_parser(tokens);
+            }));
+            if (rdMatches) {
+                results.push_back(measure(shape, "validate_rd", doc.size(), [&]() {
+                    return rdParse(tokens);
+                }));
+            }
+            results.push_back(measure(shape, "convert", doc.size(), [&]() {
+                stringstream buffer(doc);
+                return !parseJSONtoXML(buffer, 0, "root").empty();
+            }));
+            results.push_back(measure(shape, "end_to_end", doc.size(), [&]() {
+                StringSink sink;
+                return context.convert(doc.data(), doc.size(), sink);
+            }));
+#ifdef __linux__
+            // XML of the validated document to a file: gathered in a string
+            // and written, against string values written by reference with
+            // writev, as Context does for a sink that takes references
+            results.push_back(measure(shape, "emit_copy", doc.size(), [&]() {
+                InputBuffer input(doc.data(), doc.size());
+                istream buffer(&input);
+                XmlOutput xml;
+                parseJSONtoXML(buffer, xml, 0, "root");
+                return ::write(devNull, xml.data.data(), xml.data.size()) == ssize_t(xml.data.size());
+            }));
+            results.push_back(measure(shape, "emit_iovec", doc.size(), [&]() {
+                IovecSink sink({devNull});
+                InputBuffer input(doc.data(), doc.size());
+                istream buffer(&input);
+                XmlOutput xml;
+                xml.flush = [&sink](pmr::string& data) {
+                    sink.write(data.data(), data.size());
+                    data.clear();
+                };
+                xml.reference = [&sink](const char* data, size_t len) { sink.write_reference(data, len); };
+                parseJSONtoXML(buffer, xml, 0, "root");
+                return sink.flush();
+            }));
+#endif
+            // a converter generated for the shape (bench/<shape>_shape.cpp) against
+            // the generic one, both reading the buffer in place
+            if (const ShapeConverter* converter = findShapeConverter(shape + "_shape")) {
+                results.push_back(measure(shape, "convert_buffer", doc.size(), [&]() {
+                    InputBuffer input(doc.data(), doc.size());
+                    istream buffer(&input);
+                    XmlOutput xml;
+                    parseJSONtoXML(buffer, xml, 0, "root");
+                    return !xml.data.empty();
+                }));
+                results.push_back(measure(shape, "convert_shape", doc.size(), [&]() {
+                    XmlOutput xml;
+                    converter->convert(doc.data(), doc.size(), xml);
+                    return !xml.data.empty();
+                }));
+            }
+            // a stage that failed has no throughput to report or compare
+            for (size_t i = first; i < results.size();) {
+                const Result& r = results[i];
+                if (!r.ok) {
+                    cerr << "Error: " << r.shape << " " << sizeName << " " << r.stage << " failed" << endl;
+                    failed = true;
+                    results.erase(results.begin() + i);
+                    continue;
+                }
+                cout << r.shape << "\t" << sizeName << "\t" << r.stage << "\t"
+                     << r.mbPerSec << " MB/s\t" << r.docsPerSec << " docs/s\t"
+                     << r.allocsPerDoc << " allocs/doc" << endl;
+                i++;
+            }
+        }
+    }
+
+    ofstream out(outFile);
+    out << "{\"results\":[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        out << toJson(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    out.close();
+    cout << "Results written to " << outFile << endl;
+
+    if (baselineFile.empty()) return failed ? 1 : 0;
+    ifstream baseline(baselineFile);
+    if (!baseline) {
+        cerr << "Error: Cannot open baseline " << baselineFile << endl;
+        return 1;
+    }
+    int regressions = 0;
+    string line;
+    while (getline(baseline, line)) {
+        string shape = field(line, "shape"), stage = field(line, "stage"), size = field(line, "size");
+        // results of a rejected run, from before they were left out, are no baseline
+        if (shape.empty() || field(line, "ok") == "false") continue;
+        double before = atof(field(line, "mb_per_s").c_str());
+        for (const Result& r : results) {
+            if (r.shape != shape || r.stage != stage || to_string(r.size) != size) continue;
+            double change = before > 0 ? (r.mbPerSec - before) / before * 100 : 0;
+            if (change < -threshold) {
+                cout << "REGRESSION " << shape << " " << size << " " << stage << ": "
+                     << before << " -> " << r.mbPerSec << " MB/s (" << change << "%)" << endl;
+                regressions++;
+            }
+        }
+    }
+    cout << regressions << " regression(s) against " << baselineFile << endl;
+    return regressions || failed ? 1 : 0;
+}
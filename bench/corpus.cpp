@@ -0,0 +1,108 @@
+#include "corpus.h"
+
+#include <cctype>
+#include <cstdint>
+using namespace std;
+
+namespace jsontoxml {
+
+namespace {
+
+struct Random {
+    uint64_t state;
+    explicit Random(unsigned seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+    size_t below(size_t n) { return next() % n; }
+};
+
+string word(Random& rnd, size_t len) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    string w;
+    w += letters[rnd.below(52)];
+    while (w.size() < len) w += letters[rnd.below(52)];
+    // tokens.txt tries the keywords before `string`, so "trueX" scans as true + X
+    for (const char* keyword : {"true", "false", "null"}) {
+        if (w.rfind(keyword, 0) == 0) w[0] = toupper(w[0]);
+    }
+    return w;
+}
+
+void wide(string& out, size_t size, Random& rnd) {
+    out += "{\n";
+    for (size_t i = 0; out.size() < size; i++) {
+        if (i) out += ",\n";
+        out += "  \"k" + to_string(i) + "\":" + to_string(rnd.below(100000));
+    }
+    out += "\n}\n";
+}
+
+void deep(string& out, size_t size, Random& rnd) {
+    const int maxDepth = 64;
+    out += "[\n";
+    for (size_t i = 0; out.size() < size; i++) {
+        if (i) out += ",\n";
+        int depth = 1 + rnd.below(maxDepth);
+        for (int d = 0; d < depth; d++) out += "{\"n" + to_string(d) + "\":\n";
+        out += to_string(rnd.below(1000));
+        for (int d = 0; d < depth; d++) out += "}";
+    }
+    out += "\n]\n";
+}
+
+void strings(string& out, size_t size, Random& rnd) {
+    out += "{\n";
+    for (size_t i = 0; out.size() < size; i++) {
+        if (i) out += ",\n";
+        out += "  \"s" + to_string(i) + "\":\"" + word(rnd, 256 + rnd.below(3840)) + "\"";
+    }
+    out += "\n}\n";
+}
+
+void numbers(string& out, size_t size, Random& rnd) {
+    out += "[\n";
+    for (size_t i = 0; out.size() < size; i++) {
+        if (i) out += (i % 16) ? "," : ",\n";
+        out += to_string(rnd.next() % 1000000000);
+    }
+    out += "\n]\n";
+}
+
+void records(string& out, size_t size, Random& rnd) {
+    out += "[\n";
+    for (size_t i = 0; out.size() < size; i++) {
+        if (i) out += ",\n";
+        out += "  {\"id\":" + to_string(i) +
+               ",\"name\":\"" + word(rnd, 4 + rnd.below(12)) +
+               "\",\"active\":" + (rnd.below(2) ? "true" : "false") +
+               ",\"score\":" + to_string(rnd.below(100)) +
+               ",\"tags\":[\"" + word(rnd, 3) + "\",\"" + word(rnd, 5) + "\"]" +
+               ",\"parent\":null}";
+    }
+    out += "\n]\n";
+}
+
+}
+
+const vector<string>& corpusShapes() {
+    static const vector<string> shapes = {"wide", "deep", "strings", "numbers", "records"};
+    return shapes;
+}
+
+string generateCorpus(const string& shape, size_t size, unsigned seed) {
+    Random rnd(seed);
+    string out;
+    out.reserve(size + 4096);
+    if (shape == "wide") wide(out, size, rnd);
+    else if (shape == "deep") deep(out, size, rnd);
+    else if (shape == "strings") strings(out, size, rnd);
+    else if (shape == "numbers") numbers(out, size, rnd);
+    else if (shape == "records") records(out, size, rnd);
+    return out;
+}
+
+}
@@ -0,0 +1,24 @@
+#ifndef JSONTOXML_BENCH_CORPUS_H
+#define JSONTOXML_BENCH_CORPUS_H
+
+#include <string>
+#include <vector>
+
+namespace jsontoxml {
+
+// Document shapes the synthetic corpus can produce. All of them are accepted by
+// the shipped tokens.txt and grammar.txt, whose strings have no escapes.
+//   wide     one object with many short members
+//   deep     an array of deeply nested object chains
+//   strings  an object of long string values
+//   numbers  a flat array of integers
+//   records  an array of small uniform records
+const std::vector<std::string>& corpusShapes();
+
+// Builds a document of roughly `size` bytes. Output depends only on the shape,
+// the size and the seed, so runs are comparable across machines.
+std::string generateCorpus(const std::string& shape, size_t size, unsigned seed = 1);
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+// Generated by --gen-converter for documents shaped like
+//   [{id: number, name: string, active: boolean, score: number, tags: [string], parent: null}]
+// Do not edit; regenerate it when the feed's shape changes.
+#include "shape.h"
+
+#include <cctype>
+using namespace std;
+
+namespace jsontoxml {
+
+namespace {
+
+// number
+void value_2(ShapeCursor& c, XmlOutput& xml) {
+    char ch = c.peek();
+    if (!(isdigit((unsigned char)ch) || ch == '-' || ch == '+')) return c.value(xml, 2, "id");
+    xml.data.append("    <id>", 8);
+    c.copy_number(xml);
+    xml.data.append("</id>\n", 6);
+}
+
+// string
+void value_3(ShapeCursor& c, XmlOutput& xml) {
+    if (!c.take('"')) return c.value(xml, 2, "name");
+    xml.data.append("    <name>", 10);
+    c.copy_string(xml);
+    xml.data.append("</name>\n", 8);
+}
+
+// boolean
+void value_4(ShapeCursor& c, XmlOutput& xml) {
+    char ch = c.peek();
+    if (ch == 't') {
+        c.skip(4);
+        xml.data.append("    <active>true</active>\n", 26);
+    } else if (ch == 'f') {
+        c.skip(5);
+        xml.data.append("    <active>false</active>\n", 27);
+    } else {
+        c.value(xml, 2, "active");
+    }
+}
+
+// number
+void value_5(ShapeCursor& c, XmlOutput& xml) {
+    char ch = c.peek();
+    if (!(isdigit((unsigned char)ch) || ch == '-' || ch == '+')) return c.value(xml, 2, "score");
+    xml.data.append("    <score>", 11);
+    c.copy_number(xml);
+    xml.data.append("</score>\n", 9);
+}
+
+// string
+void value_7(ShapeCursor& c, XmlOutput& xml) {
+    if (!c.take('"')) return c.value(xml, 3, "item");
+    xml.data.append("      <item>", 12);
+    c.copy_string(xml);
+    xml.data.append("</item>\n", 8);
+}
+
+// [string]
+void value_6(ShapeCursor& c, XmlOutput& xml) {
+    if (!c.take('[')) return c.value(xml, 2, "tags");
+    for (;;) {
+        char ch = c.peek();
+        if (!ch || ch == ']') {
+            c.skip(1);
+            break;
+        }
+        xml.data.append("    <tags>\n", 11);
+        value_7(c, xml);
+        xml.data.append("    </tags>\n", 12);
+        xml.element_done();
+        ch = c.peek();
+        if (ch == ',' || ch == ']') c.skip(1);
+        if (!ch || ch == ']') break;
+    }
+}
+
+// null
+void value_8(ShapeCursor& c, XmlOutput& xml) {
+    if (c.peek() != 'n') return c.value(xml, 2, "parent");
+    c.skip(4);
+    xml.data.append("    <parent/>\n", 14);
+}
+
+// {id: number, name: string, active: boolean, score: number, tags: [string], parent: null}
+void value_1(ShapeCursor& c, XmlOutput& xml) {
+    if (!c.take('{')) return c.value(xml, 1, "item");
+    xml.data.append("  <item>\n", 9);
+    if (!c.take_key("\"id\"", 4)) return c.members(xml, 1, "item");
+    value_2(c, xml);
+    if (!c.take(',') || !c.take_key("\"name\"", 6)) return c.members(xml, 1, "item");
+    value_3(c, xml);
+    if (!c.take(',') || !c.take_key("\"active\"", 8)) return c.members(xml, 1, "item");
+    value_4(c, xml);
+    if (!c.take(',') || !c.take_key("\"score\"", 7)) return c.members(xml, 1, "item");
+    value_5(c, xml);
+    if (!c.take(',') || !c.take_key("\"tags\"", 6)) return c.members(xml, 1, "item");
+    value_6(c, xml);
+    if (!c.take(',') || !c.take_key("\"parent\"", 8)) return c.members(xml, 1, "item");
+    value_8(c, xml);
+    if (!c.take('}')) return c.members(xml, 1, "item");
+    xml.data.append("  </item>\n", 10);
+    xml.element_done();
+}
+
+// root [{id: number, name: string, active: boolean, score: number, tags: [string], parent: null}]
+void value_0(ShapeCursor& c, XmlOutput& xml) {
+    if (!c.take('[')) return c.value(xml, 0, "root");
+    for (;;) {
+        char ch = c.peek();
+        if (!ch || ch == ']') {
+            c.skip(1);
+            break;
+        }
+        xml.data.append("<root>\n", 7);
+        value_1(c, xml);
+        xml.data.append("</root>\n", 8);
+        xml.element_done();
+        ch = c.peek();
+        if (ch == ',' || ch == ']') c.skip(1);
+        if (!ch || ch == ']') break;
+    }
+}
+
+void convert(const char* in, size_t len, XmlOutput& xml) {
+    ShapeCursor c{in, in + len};
+    if (c.peek() == '[') value_0(c, xml);
+    c.finish(xml);
+}
+
+const ShapeRegistration registration({"records_shape", convert});
+}
+
+}
@@ -0,0 +1,234 @@
+#include "codegen.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+using namespace std;
+
+namespace jsontoxml {
+
+static vector<string> splitSymbols(const string& rule) {
+    stringstream ss(rule);
+    string sym;
+    vector<string> result;
+    while (ss >> sym) result.push_back(sym);
+    return result;
+}
+
+static string joinSymbols(const vector<string>& symbols) {
+    string result;
+    for (size_t i = 0; i < symbols.size(); i++) {
+        if (i) result += ' ';
+        result += symbols[i];
+    }
+    return result;
+}
+
+static string cString(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') out += "\\n\"\n    \"";
+        else out += c;
+    }
+    return out + "\"";
+}
+
+// Keeps comments from being closed or continued by a symbol.
+static string commentSafe(const string& s) {
+    string out;
+    for (char c : s) {
+        if (c == '*' || c == '/' || c == '\\') out += '_';
+        else out += c;
+    }
+    return out;
+}
+
+static string identifier(const string& s) {
+    string out;
+    for (char c : s) out += isalnum((unsigned char)c) ? c : '_';
+    return out;
+}
+
+string grammarSignature(const string& startsymbol, const vector<Predictive_table>& table) {
+    string sig = "start " + startsymbol + "\n";
+    for (const Predictive_table& entry : table) {
+        sig += entry.nonterminal + " " + entry.first + " -> " + joinSymbols(splitSymbols(entry.rule)) + "\n";
+    }
+    return sig;
+}
+
+bool generateParser(const Grammar& grammar, const vector<Predictive_table>& table,
+                    ostream& out, string& error) {
+    // terminal ids: 0 is end of input, the grammar's terminals follow in order
+    map<string, string> terminalIds;
+    terminalIds["$"] = "T_END";
+    vector<string> terminals;
+    for (size_t i = 0; i < grammar.terminals.size(); i++) {
+        terminalIds[grammar.terminals[i]] = "T_" + to_string(i + 1);
+        terminals.push_back(grammar.terminals[i]);
+    }
+    map<string, string> functions;
+    for (size_t i = 0; i < grammar.nonterminals.size(); i++) {
+        functions[grammar.nonterminals[i]] = "parse_" + to_string(i) + "_" + identifier(grammar.nonterminals[i]);
+    }
+    if (!functions.count(grammar.startsymbol)) {
+        error = "Error: Start symbol " + grammar.startsymbol + " is not a nonterminal";
+        return false;
+    }
+
+    // rows[nonterminal] = list of (rule symbols, lookahead terminals), in table order
+    map<string, vector<pair<vector<string>, vector<string>>>> rows;
+    map<pair<string, string>, bool> seen;
+    for (const Predictive_table& entry : table) {
+        if (seen[{entry.nonterminal, entry.first}]) {
+            error = "Error: Conflict in parse table at (" + entry.nonterminal + "," + entry.first + ")";
+            return false;
+        }
+        seen[{entry.nonterminal, entry.first}] = true;
+        if (!terminalIds.count(entry.first) || !functions.count(entry.nonterminal)) {
+            error = "Error: Unknown symbol in parse table entry (" + entry.nonterminal + "," + entry.first + ")";
+            return false;
+        }
+        vector<string> symbols = splitSymbols(entry.rule);
+        for (const string& sym : symbols) {
+            if (sym != "e" && !terminalIds.count(sym) && !functions.count(sym)) {
+                error = "Error: Unknown symbol " + sym + " in rule " + entry.rule;
+                return false;
+            }
+        }
+        auto& row = rows[entry.nonterminal];
+        bool merged = false;
+        for (auto& alt : row) {
+            if (alt.first == symbols) {
+                alt.second.push_back(entry.first);
+                merged = true;
+            }
+        }
+        if (!merged) row.push_back({symbols, {entry.first}});
+    }
+
+    out << "// Generated by --gen-parser from the LL(1) table of grammar.txt. Do not edit;\n"
+           "// regenerate it whenever grammar.txt changes.\n"
+           "#include \"rd_parser.h\"\n\n"
+           "#include <string_view>\n"
+           "using namespace std;\n\n"
+           "namespace jsontoxml {\n\n"
+           "const char* const rdGrammarSignature =\n    "
+        << cString(grammarSignature(grammar.startsymbol, table)) << ";\n\n"
+           "namespace {\n\n"
+           "enum Terminal {\n    T_END,\n";
+    for (size_t i = 0; i < terminals.size(); i++) {
+        out << "    " << terminalIds[terminals[i]] << ", // " << commentSafe(terminals[i]) << "\n";
+    }
+    out << "    T_UNKNOWN\n};\n\n"
+           "Terminal terminalOf(string_view name) {\n";
+    for (const string& t : terminals) {
+        out << "    if (name == " << cString(t) << ") return " << terminalIds[t] << ";\n";
+    }
+    out << "    return T_UNKNOWN;\n}\n\n"
+           "struct VectorSource {\n"
+           "    const Token* at;\n"
+           "    const Token* end;\n"
+           "    Terminal next() { return at == end ? T_END : terminalOf((at++)->name); }\n"
+           "};\n\n"
+           "struct GeneratorSource {\n"
+           "    Generator<Token>::iterator at, end;\n"
+           "    Terminal next() {\n"
+           "        if (at == end) return T_END;\n"
+           "        Terminal t = terminalOf(at->name);\n"
+           "        ++at;\n"
+           "        return t;\n"
+           "    }\n"
+           "};\n\n"
+           "template <class Source>\n"
+           "struct Parser {\n"
+           "    Source src;\n"
+           "    Terminal la = T_END;\n\n"
+           "    bool match(Terminal t) {\n"
+           "        if (la != t) return false;\n"
+           "        la = src.next();\n"
+           "        return true;\n"
+           "    }\n";
+    for (const string& nt : grammar.nonterminals) out << "    bool " << functions[nt] << "();\n";
+    out << "};\n";
+
+    for (const string& nt : grammar.nonterminals) {
+        const auto& row = rows[nt];
+        bool loops = false;
+        for (const auto& alt : row) {
+            if (!alt.first.empty() && alt.first.back() == nt) loops = true;
+        }
+        string pad = loops ? "        " : "    ";
+        out << "\n// " << commentSafe(nt) << "\n"
+            << "template <class Source>\n"
+            << "bool Parser<Source>::" << functions[nt] << "() {\n";
+        if (loops) out << "    for (;;) {\n";
+        out << pad << "switch (la) {\n";
+        for (const auto& alt : row) {
+            for (const string& t : alt.second) {
+                out << pad << "case " << terminalIds[t] << ": // " << commentSafe(t) << "\n";
+            }
+            vector<string> symbols = alt.first;
+            if (symbols.size() == 1 && symbols[0] == "e") symbols.clear();
+            bool tail = !symbols.empty() && symbols.back() == nt;
+            if (tail) symbols.pop_back();
+            string cond;
+            for (const string& sym : symbols) {
+                if (!cond.empty()) cond += " && ";
+                cond += terminalIds.count(sym) ? "match(" + terminalIds[sym] + ")" : functions[sym] + "()";
+            }
+            out << pad << "    // " << commentSafe(nt) << " -> " << commentSafe(joinSymbols(alt.first)) << "\n";
+            if (tail) {
+                if (!cond.empty()) out << pad << "    if (!(" << cond << ")) return false;\n";
+                out << pad << "    continue;\n";
+            } else {
+                out << pad << "    return " << (cond.empty() ? "true" : cond) << ";\n";
+            }
+        }
+        out << pad << "default:\n"
+            << pad << "    return false;\n"
+            << pad << "}\n";
+        if (loops) out << "    }\n";
+        out << "}\n";
+    }
+
+    string start = functions[grammar.startsymbol];
+    out << "\n}\n\n"
+           "bool rdParse(const TokenList& tokens) {\n"
+           "    Parser<VectorSource> parser{VectorSource{tokens.data(), tokens.data() + tokens.size()}};\n"
+           "    parser.la = parser.src.next();\n"
+           "    return parser." << start << "() && parser.la == T_END;\n"
+           "}\n\n"
+           "bool rdParse(Generator<Token>& tokens) {\n"
+           "    Parser<GeneratorSource> parser{GeneratorSource{tokens.begin(), tokens.end()}};\n"
+           "    parser.la = parser.src.next();\n"
+           "    return parser." << start << "() && parser.la == T_END;\n"
+           "}\n\n"
+           "}\n";
+    return true;
+}
+
+bool generateParserFile(const string& grammar_file, const string& output_file, string& error) {
+    Grammar grammar;
+    if (!readGrammar(grammar_file, grammar)) {
+        error = "Error: Cannot open " + grammar_file;
+        return false;
+    }
+    SymbolSets firstSets = computeFirst(grammar);
+    SymbolSets followSets = computeFollow(grammar, firstSets);
+    ParsingTable table(grammar, firstSets, followSets);
+    table.build_parsing_table();
+
+    stringstream code;
+    if (!generateParser(table.get_grammar(), table.get_table(), code, error)) return false;
+    ofstream out(output_file);
+    out << code.str();
+    if (!out) {
+        error = "Error: Cannot write " + output_file;
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef JSONTOXML_CODEGEN_H
+#define JSONTOXML_CODEGEN_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "grammar.h"
+
+namespace jsontoxml {
+
+// Canonical text of an LL(1) table: the start symbol, then one line per
+// (nonterminal, terminal, rule) entry. The generated parser embeds it so a
+// Context can tell whether the loaded grammar is the one it was built from.
+std::string grammarSignature(const std::string& startsymbol, const std::vector<Predictive_table>& table);
+
+// Writes a C++ source file with a recursive-descent recognizer for the
+// grammar: one function per nonterminal whose table row becomes a switch on
+// the lookahead terminal, with right recursion into the same nonterminal
+// turned into a loop. It defines rdParse() and rdGrammarSignature from
+// rd_parser.h.
+bool generateParser(const Grammar& grammar, const std::vector<Predictive_table>& table,
+                    std::ostream& out, std::string& error);
+
+// Loads grammar_file, builds its table and writes the parser to output_file.
+bool generateParserFile(const std::string& grammar_file, const std::string& output_file, std::string& error);
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "compress.h"
+
+#include <thread>
+#include <zlib.h>
+#ifdef JSONTOXML_ZSTD
+#include <zstd.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+bool compressionAvailable(Compression format) {
+#ifdef JSONTOXML_ZSTD
+    return true;
+#else
+    return format == Compression::GZIP;
+#endif
+}
+
+// One complete gzip member; an empty string on failure.
+static string gzipBlock(const string& in, int level) {
+    z_stream zs = {};
+    if (deflateInit2(&zs, level < 0 ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED,
+                     15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return "";
+    }
+    string out(deflateBound(&zs, in.size()), '\0');
+    zs.next_in = (Bytef*)in.data();
+    zs.avail_in = in.size();
+    zs.next_out = (Bytef*)&out[0];
+    zs.avail_out = out.size();
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? out : "";
+}
+
+#ifdef JSONTOXML_ZSTD
+static string zstdBlock(const string& in, int level) {
+    string out(ZSTD_compressBound(in.size()), '\0');
+    size_t n = ZSTD_compress(&out[0], out.size(), in.data(), in.size(), level < 0 ? 3 : level);
+    if (ZSTD_isError(n)) return "";
+    out.resize(n);
+    return out;
+}
+#endif
+
+CompressedSink::CompressedSink(Sink& out, Compression format, int level, size_t block_size, unsigned threads)
+    : out(out), format(format), level(level), block_size(block_size ? block_size : 1 << 20) {
+    if (!threads) threads = thread::hardware_concurrency();
+    max_pending = threads ? threads : 1;
+    if (!compressionAvailable(format)) {
+        message = string("Error: ") + (format == Compression::ZSTD ? "zstd" : "gzip") + " support is not compiled in";
+        failed = finished = true;
+        return;
+    }
+    block.reserve(this->block_size);
+}
+
+CompressedSink::~CompressedSink() {
+    finish();
+}
+
+bool CompressedSink::ok() const {
+    return message.empty();
+}
+
+const string& CompressedSink::error() const {
+    return message;
+}
+
+void CompressedSink::write(const char* data, size_t len) {
+    if (finished) return;
+    while (len) {
+        size_t n = min(len, block_size - block.size());
+        block.append(data, n);
+        data += n;
+        len -= n;
+        if (block.size() == block_size) submit();
+    }
+}
+
+void CompressedSink::submit() {
+    drain(max_pending - 1);
+    submitted = true;
+    Compression f = format;
+    int lvl = level;
+    pending.push_back(async(launch::async, [f, lvl](string in) {
+        switch (f) {
+#ifdef JSONTOXML_ZSTD
+        case Compression::ZSTD:
+            return zstdBlock(in, lvl);
+#endif
+        case Compression::GZIP:
+            return gzipBlock(in, lvl);
+        default: // rejected by the constructor
+            return string();
+        }
+    }, move(block)));
+    block = string();
+    block.reserve(block_size);
+}
+
+// Writes finished blocks in order until at most `keep` are still in flight.
+void CompressedSink::drain(size_t keep) {
+    while (pending.size() > keep) {
+        string compressed = pending.front().get();
+        pending.pop_front();
+        if (compressed.empty()) failed = true;
+        else out.write(compressed.data(), compressed.size());
+    }
+}
+
+bool CompressedSink::finish() {
+    if (finished) return !failed;
+    finished = true;
+    // an empty input still gets one (empty) member, so the output is a valid stream
+    if (!block.empty() || !submitted) submit();
+    drain(0);
+    return !failed;
+}
+
+}
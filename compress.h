@@ -0,0 +1,61 @@
+#ifndef JSONTOXML_COMPRESS_H
+#define JSONTOXML_COMPRESS_H
+
+#include <deque>
+#include <future>
+#include <string>
+
+#include "jsontoxml.h"
+
+namespace jsontoxml {
+
+enum class Compression { GZIP, ZSTD };
+
+// False when the format was not compiled in (zstd needs -DJSONTOXML_ZSTD and -lzstd).
+bool compressionAvailable(Compression format);
+
+// Compresses everything written to it and passes the result on to `out`.
+// Input is cut into `block_size` blocks which are compressed independently
+// on up to `threads` worker threads and written in order, each block as a
+// complete gzip member or zstd frame. Concatenated members/frames are a
+// standard stream, so gzip -d and zstd -d read the output as usual.
+//
+// A format that was not compiled in leaves the sink not ok(): nothing is
+// written to `out` and finish() returns false.
+class CompressedSink : public Sink {
+public:
+    CompressedSink(Sink& out, Compression format, int level = -1,
+                   size_t block_size = 1 << 20, unsigned threads = 0);
+    ~CompressedSink();
+    CompressedSink(const CompressedSink&) = delete;
+    CompressedSink& operator=(const CompressedSink&) = delete;
+
+    // False when `format` is not available; error() then says why.
+    bool ok() const;
+    const std::string& error() const;
+
+    void write(const char* data, size_t len) override;
+    // Compresses what is left and waits for every block to reach `out`.
+    // Returns false if a block failed to compress.
+    bool finish();
+
+private:
+    void submit();
+    void drain(size_t keep);
+
+    Sink& out;
+    Compression format;
+    int level;
+    size_t block_size;
+    size_t max_pending;
+    std::string block;
+    std::deque<std::future<std::string>> pending;
+    std::string message;
+    bool submitted = false;
+    bool failed = false;
+    bool finished = false;
+};
+
+}
+
+#endif
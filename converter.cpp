@@ -0,0 +1,170 @@
+#include "converter.h"
+
+#include <cctype>
+#include <cstring>
+
+#include "memory.h"
+using namespace std;
+
+namespace jsontoxml {
+
+string indent(int level) {
+    return string(level * 2, ' ');
+}
+string trim(const string& s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    size_t end = s.find_last_not_of(" \t\r\n");
+    if (start == string::npos || end == string::npos) return "";
+    return s.substr(start, end - start + 1);
+}
+size_t inputOffset(istream& ss) {
+    // straight to the streambuf: tellg() gives -1 once eofbit is set
+    return size_t(ss.rdbuf()->pubseekoff(0, ios_base::cur, ios_base::in));
+}
+void parseString(istream& ss, pmr::string& result) {
+    char ch;
+    while (ss.get(ch)) {
+        if (ch == '"') break;
+        result += ch;
+    }
+}
+static void openTag(XmlOutput& xml, int level, string_view tag) {
+    xml.indent(level);
+    xml += '<';
+    xml += tag;
+    xml += ">";
+}
+static void closeTag(XmlOutput& xml, string_view tag) {
+    xml += "</";
+    xml += tag;
+    xml += ">\n";
+}
+void parseObject(istream& ss, XmlOutput& xml, int level, string_view tag) {
+    openTag(xml, level, tag);
+    xml += '\n';
+    parseMembers(ss, xml, level, tag);
+}
+void parseMembers(istream& ss, XmlOutput& xml, int level, string_view tag) {
+    pmr::string key(xml.data.get_allocator());
+    char ch;
+
+    while (ss >> ch) {
+        if (ch == '"') {
+            key.clear();
+            parseString(ss, key);
+
+            // skip colon
+            while (ss >> ch && ch != ':');
+
+            if (xml.observer) xml.observer->enter_key(key, xml.offset(), inputOffset(ss));
+            parseValue(ss, xml, level + 1, key);
+            if (xml.observer) xml.observer->leave(xml.offset(), inputOffset(ss));
+        } else if (ch == '}') {
+            break;
+        }
+    }
+
+    xml.indent(level);
+    closeTag(xml, tag);
+    xml.element_done();
+}
+void parseArray(istream& ss, XmlOutput& xml, int level, string_view tag) {
+    size_t i = 0;
+    char ch;
+
+    while (ss >> ch) {
+        if (ch == ']') break;
+        ss.putback(ch);
+
+        if (xml.observer) xml.observer->enter_index(i, xml.offset(), inputOffset(ss));
+        i++;
+        parseArrayElement(ss, xml, level, tag);
+        if (xml.observer) xml.observer->leave(xml.offset(), inputOffset(ss));
+        xml.element_done();
+
+        ss >> ch;
+        if (ch != ',' && ch != ']') ss.putback(ch);
+        if (ch == ']') break;
+    }
+}
+void parseArrayElement(istream& ss, XmlOutput& xml, int level, string_view tag) {
+    openTag(xml, level, tag);
+    xml += '\n';
+    parseValue(ss, xml, level + 1, "item");
+    xml.indent(level);
+    closeTag(xml, tag);
+}
+void parseValue(istream& ss, XmlOutput& xml, int level, string_view tag) {
+    char ch;
+    while (ss >> ch) {
+        if (ch == '"') {
+            openTag(xml, level, tag);
+            InputBuffer* raw = xml.reference ? dynamic_cast<InputBuffer*>(ss.rdbuf()) : nullptr;
+            if (raw) {
+                // the value can go out by reference, straight from the input
+                const char* close = (const char*)memchr(raw->cursor(), '"', raw->limit() - raw->cursor());
+                if (!close) close = raw->limit();
+                xml.verbatim(raw->cursor(), close - raw->cursor());
+                raw->seek_to(close == raw->limit() ? close : close + 1);
+            } else {
+                parseString(ss, xml.data);
+            }
+            closeTag(xml, tag);
+            return;
+        } else if (isdigit(ch) || ch == '-' || ch == '+') {
+            openTag(xml, level, tag);
+            xml += ch;
+            while (ss.peek() != EOF && (isdigit(ss.peek()) || ss.peek() == '.')) {
+                xml += (char)ss.get();
+            }
+            closeTag(xml, tag);
+            return;
+        } else if (ch == 't') { // true
+            ss.ignore(3);
+            openTag(xml, level, tag);
+            xml += "true";
+            closeTag(xml, tag);
+            return;
+        } else if (ch == 'f') { // false
+            ss.ignore(4);
+            openTag(xml, level, tag);
+            xml += "false";
+            closeTag(xml, tag);
+            return;
+        } else if (ch == 'n') { // null
+            ss.ignore(3);
+            xml.indent(level);
+            xml += '<';
+            xml += tag;
+            xml += "/>\n";
+            return;
+        } else if (ch == '{') {
+            parseObject(ss, xml, level, tag);
+            return;
+        } else if (ch == '[') {
+            parseArray(ss, xml, level, tag);
+            return;
+        }
+    }
+}
+void parseJSONtoXML(istream& ss, XmlOutput& xml, int level, string_view currentTag) {
+    char ch;
+
+    if (xml.observer) xml.observer->enter_root(xml.offset(), inputOffset(ss));
+    while (ss >> ch) {
+        if (ch == '{') {
+            parseObject(ss, xml, level, currentTag);
+        } else if (ch == '[') {
+            parseArray(ss, xml, level, currentTag);
+        }
+    }
+    if (xml.observer) xml.observer->leave(xml.offset(), inputOffset(ss));
+    xml.finish();
+}
+string parseJSONtoXML(istream& ss, int level, string_view currentTag) {
+    XmlOutput xml;
+    parseJSONtoXML(ss, xml, level, currentTag);
+    return string(xml.data);
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef JSONTOXML_CONVERTER_H
+#define JSONTOXML_CONVERTER_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+namespace jsontoxml {
+
+// Told where each value starts and ends, in the JSON input and in the XML,
+// as the converter writes it. Input offsets are stream positions: on entry
+// the value may still be preceded by whitespace, on leave the stream is just
+// past it. Keys are entered for object members, indexes for array elements.
+class ConvertObserver {
+public:
+    virtual ~ConvertObserver() = default;
+    virtual void enter_root(uint64_t xml_offset, size_t json_offset) = 0;
+    virtual void enter_key(std::string_view key, uint64_t xml_offset, size_t json_offset) = 0;
+    virtual void enter_index(size_t index, uint64_t xml_offset, size_t json_offset) = 0;
+    virtual void leave(uint64_t xml_offset, size_t json_offset) = 0;
+};
+
+// Collects the generated XML. With a block size set, every `block_size` bytes
+// of finished elements are handed to `flush`, which must empty `data`.
+// Keys and output are allocated from `memory`, so a per-document arena keeps
+// the converter off the global heap. With `observer` set, the converter also
+// reports the input and output span of every value it writes. With
+// `reference` set as well, string values of at least `reference_min` bytes
+// are not copied: `data` is flushed to keep the order and the span of the
+// input is handed to `reference` instead.
+struct XmlOutput {
+    std::pmr::string data;
+    size_t block_size = 0;
+    std::function<void(std::pmr::string&)> flush;
+    ConvertObserver* observer = nullptr;
+    uint64_t flushed = 0;
+    std::function<void(const char*, size_t)> reference;
+    size_t reference_min = 64;
+
+    explicit XmlOutput(std::pmr::memory_resource* memory = std::pmr::get_default_resource()) : data(memory) {}
+    XmlOutput& operator+=(std::string_view s) { data += s; return *this; }
+    XmlOutput& operator+=(char c) { data += c; return *this; }
+    void indent(int level) { data.append(level * 2, ' '); }
+    // Offset of the next byte written, counting everything already flushed.
+    uint64_t offset() const { return flushed + data.size(); }
+    // Bytes of the input that appear in the output as they are.
+    void verbatim(const char* p, size_t n) {
+        if (reference && flush && n >= reference_min) {
+            flushed += data.size();
+            flush(data);
+            reference(p, n);
+            flushed += n;
+        } else {
+            data.append(p, n);
+        }
+    }
+    void element_done() {
+        if (block_size && data.size() >= block_size && flush) {
+            flushed += data.size();
+            flush(data);
+        }
+    }
+    void finish() {
+        if (flush && !data.empty()) {
+            flushed += data.size();
+            flush(data);
+        }
+    }
+};
+
+// JSON file to XML file
+std::string indent(int level);
+std::string trim(const std::string& s);
+std::string parseJSONtoXML(std::istream& ss, int level = 0, std::string_view currentTag = "root");
+void parseJSONtoXML(std::istream& ss, XmlOutput& xml, int level = 0, std::string_view currentTag = "root");
+void parseValue(std::istream& ss, XmlOutput& xml, int level, std::string_view tag);
+// Reads up to the closing quote, appending to `result`.
+void parseString(std::istream& ss, std::pmr::string& result);
+void parseObject(std::istream& ss, XmlOutput& xml, int level, std::string_view tag);
+// The members of an object whose opening tag is already written, up to and
+// including its closing tag.
+void parseMembers(std::istream& ss, XmlOutput& xml, int level, std::string_view tag);
+void parseArray(std::istream& ss, XmlOutput& xml, int level, std::string_view tag);
+// One element of an array named `tag`: the <tag> wrapper at `level` around the item.
+void parseArrayElement(std::istream& ss, XmlOutput& xml, int level, std::string_view tag);
+// Current read position of `ss`, for ConvertObserver.
+size_t inputOffset(std::istream& ss);
+
+}
+
+#endif
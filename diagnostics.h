@@ -0,0 +1,49 @@
+#ifndef JSONTOXML_DIAGNOSTICS_H
+#define JSONTOXML_DIAGNOSTICS_H
+
+#include <string>
+#include <vector>
+
+namespace jsontoxml {
+
+// One problem found by a recovering scan or parse.
+struct Diagnostic {
+    size_t offset = 0;
+    // Filled in from `offset` by whoever holds the input (Context::diagnose).
+    int line = 0;
+    int column = 0;
+    std::string message;
+    // Terminals the parser could have accepted instead; empty for scan errors.
+    std::vector<std::string> expected;
+};
+
+// Collects diagnostics until `limit` of them have been found.
+struct Diagnostics {
+    explicit Diagnostics(size_t limit = 100) : limit(limit) {}
+    std::vector<Diagnostic> list;
+    size_t limit;
+    bool full() const { return list.size() >= limit; }
+    void add(Diagnostic diagnostic) {
+        if (!full()) list.push_back(std::move(diagnostic));
+    }
+};
+
+// "line 3, column 14: Expected ... (expected one of: , })"
+inline std::string formatDiagnostic(const Diagnostic& diagnostic) {
+    std::string text = "line " + std::to_string(diagnostic.line) + ", column " +
+                       std::to_string(diagnostic.column) + ": " + diagnostic.message;
+    if (!diagnostic.expected.empty()) {
+        text += " (expected ";
+        if (diagnostic.expected.size() > 1) text += "one of: ";
+        for (size_t i = 0; i < diagnostic.expected.size(); i++) {
+            if (i) text += ' ';
+            text += diagnostic.expected[i];
+        }
+        text += ')';
+    }
+    return text;
+}
+
+}
+
+#endif
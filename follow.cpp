@@ -0,0 +1,223 @@
+#include "follow.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+static volatile sig_atomic_t stopRequested = 0;
+static void requestStop(int) { stopRequested = 1; }
+
+namespace {
+struct FollowState {
+    uint64_t offset = 0;      // input bytes consumed
+    uint64_t output_size = 0; // output bytes written for them
+    uint64_t inode = 0;       // input file they were read from
+};
+
+// Waits for the input to change. The directory is watched rather than the
+// file, so a rotated or recreated input is noticed as well; without inotify
+// it falls back to sleeping for the poll interval.
+class Watcher {
+public:
+    Watcher(const string& path, int poll_ms) : poll_ms(poll_ms) {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0) {
+            string dir = filesystem::path(path).parent_path().string();
+            if (dir.empty()) dir = ".";
+            if (inotify_add_watch(fd, dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+#endif
+    }
+    ~Watcher() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    void wait() {
+#ifdef __linux__
+        if (fd >= 0) {
+            pollfd p = {fd, POLLIN, 0};
+            if (poll(&p, 1, poll_ms) > 0) {
+                char events[4096];
+                while (read(fd, events, sizeof(events)) > 0) {}
+            }
+            return;
+        }
+#endif
+        this_thread::sleep_for(chrono::milliseconds(poll_ms));
+    }
+
+private:
+    int fd = -1;
+    int poll_ms;
+};
+}
+
+static bool loadState(const string& file, FollowState& state) {
+    ifstream in(file);
+    return in && (in >> state.offset >> state.output_size >> state.inode);
+}
+
+static bool saveState(const string& file, const FollowState& state) {
+    // write then rename, so a crash never leaves half a state file behind
+    string tmp = file + ".tmp";
+    ofstream out(tmp);
+    out << state.offset << ' ' << state.output_size << ' ' << state.inode << '\n';
+    out.close();
+    if (!out || rename(tmp.c_str(), file.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool statFile(const string& path, uint64_t& inode, uint64_t& size) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    inode = uint64_t(st.st_ino);
+    size = uint64_t(st.st_size);
+    return true;
+}
+
+bool followFile(Context& context, const string& input, const string& output,
+                const FollowOptions& options, string& error) {
+    string stateFile = options.state_file.empty() ? output + ".offset" : options.state_file;
+    FollowState state;
+    if (loadState(stateFile, state)) {
+        // XML written after the last persisted record is written again below
+        error_code ec;
+        uint64_t written = filesystem::exists(output, ec) ? filesystem::file_size(output, ec) : 0;
+        if (written > state.output_size) {
+            filesystem::resize_file(output, state.output_size, ec);
+        } else if (written < state.output_size) {
+            cerr << "Warning: '" << output << "' is shorter than recorded in '" << stateFile
+                 << "'; appending to it as it is" << endl;
+            state.output_size = written;
+        }
+        if (ec) {
+            error = "Error: Cannot resume '" + output + "': " + ec.message();
+            return false;
+        }
+    }
+    ofstream out(output, ios::binary | ios::app);
+    if (!out) {
+        error = "Error: Cannot open output file '" + output + "'";
+        return false;
+    }
+
+    ifstream in;
+    uint64_t inode = 0;   // file `in` has open
+    uint64_t read_to = 0; // how far `in` has been read; state.offset + pending.size()
+    string pending;       // bytes read past the last consumed line
+    vector<char> chunk(1 << 20);
+    StringSink sink;
+    string batch;
+
+    // Converts the complete lines in `pending`, appends their XML and
+    // persists how far the input has been consumed.
+    auto consume = [&]() -> bool {
+        batch.clear();
+        size_t start = 0, newline;
+        while ((newline = pending.find('\n', start)) != string::npos) {
+            const char* line = pending.data() + start;
+            size_t len = newline - start;
+            if (string_view(line, len).find_first_not_of(" \t\r") != string_view::npos) {
+                sink.str.clear();
+                if (context.convert(line, len, sink)) batch += sink.str;
+                else cerr << "Line at byte " << state.offset + start << " of '" << input << "': " << context.error() << endl;
+            }
+            start = newline + 1;
+        }
+        if (start == 0) return true;
+        out.write(batch.data(), batch.size());
+        if (!out.flush()) {
+            error = "Error: Cannot write output file '" + output + "'";
+            return false;
+        }
+        state.offset += start;
+        state.output_size += batch.size();
+        state.inode = inode;
+        pending.erase(0, start);
+        if (!saveState(stateFile, state)) {
+            error = "Error: Cannot write state file '" + stateFile + "'";
+            return false;
+        }
+        return true;
+    };
+    auto drain = [&]() -> bool {
+        for (;;) {
+            in.clear();
+            in.seekg(read_to);
+            in.read(chunk.data(), chunk.size());
+            size_t n = size_t(in.gcount());
+            if (n == 0) return true;
+            read_to += n;
+            pending.append(chunk.data(), n);
+            if (!consume()) return false;
+        }
+    };
+
+    stopRequested = 0;
+    auto oldInt = signal(SIGINT, requestStop);
+    auto oldTerm = signal(SIGTERM, requestStop);
+    Watcher watcher(input, options.poll_ms);
+    bool ok = true;
+    while (ok && !stopRequested) {
+        uint64_t current, size;
+        if (statFile(input, current, size)) {
+            if (current != inode) {
+                // finish the file that was rotated away before moving on
+                if (in.is_open()) {
+                    ok = drain();
+                    if (ok && !pending.empty()) {
+                        cerr << "Warning: Dropped an unterminated last line of the rotated '" << input << "'" << endl;
+                    }
+                    in.close();
+                }
+                in.open(input, ios::binary);
+                if (ok && in) {
+                    if (state.inode != current) {
+                        state.offset = 0;
+                        state.inode = current;
+                    }
+                    inode = current;
+                    read_to = state.offset;
+                    pending.clear();
+                }
+            }
+            if (ok && in.is_open() && size < read_to) {
+                cerr << "Warning: '" << input << "' was truncated; reading it from the start" << endl;
+                state.offset = read_to = 0;
+                pending.clear();
+            }
+            if (ok && in.is_open()) ok = drain();
+        }
+        if (ok) watcher.wait();
+    }
+    signal(SIGINT, oldInt);
+    signal(SIGTERM, oldTerm);
+    return ok;
+}
+
+}
@@ -0,0 +1,31 @@
+#ifndef JSONTOXML_FOLLOW_H
+#define JSONTOXML_FOLLOW_H
+
+#include <string>
+
+#include "jsontoxml.h"
+
+namespace jsontoxml {
+
+struct FollowOptions {
+    // Where progress is kept between runs; "<output>.offset" when empty.
+    std::string state_file;
+    // How often the input is checked when inotify is unavailable, and the
+    // longest a wait for an inotify event lasts.
+    int poll_ms = 500;
+};
+
+// Tails a JSON Lines file: every complete line appended to `input` is
+// converted as a document of its own and its XML appended to `output`.
+// A line is only consumed once its newline has arrived; rejected lines are
+// reported on cerr and skipped. After each batch the consumed input offset
+// and the output size are written to the state file, so a restarted run
+// resumes after the last persisted record, dropping any XML written past
+// it. A rotated or truncated input is drained and then read from the start.
+// Runs until SIGINT or SIGTERM; returns false on an I/O error.
+bool followFile(Context& context, const std::string& input, const std::string& output,
+                const FollowOptions& options, std::string& error);
+
+}
+
+#endif
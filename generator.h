@@ -0,0 +1,75 @@
+#ifndef JSONTOXML_GENERATOR_H
+#define JSONTOXML_GENERATOR_H
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace jsontoxml {
+
+// Minimal lazy C++20 generator: the coroutine body runs only as far as the
+// next co_yield each time the consumer advances the iterator.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr exception;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T v) {
+            value = std::move(v);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    class iterator {
+    public:
+        explicit iterator(std::coroutine_handle<promise_type> h = nullptr) : handle(h) {}
+        T& operator*() const { return *handle.promise().value; }
+        T* operator->() const { return &*handle.promise().value; }
+        iterator& operator++() {
+            advance(handle);
+            if (handle.done()) handle = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return handle == other.handle; }
+        bool operator!=(const iterator& other) const { return handle != other.handle; }
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    explicit Generator(std::coroutine_handle<promise_type> h) : handle(h) {}
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle) handle.destroy();
+    }
+
+    iterator begin() {
+        advance(handle);
+        return handle.done() ? iterator() : iterator(handle);
+    }
+    iterator end() { return iterator(); }
+
+private:
+    static void advance(std::coroutine_handle<promise_type> h) {
+        h.promise().value.reset();
+        h.resume();
+        if (h.promise().exception) std::rethrow_exception(h.promise().exception);
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+}
+
+#endif
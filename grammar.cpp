@@ -0,0 +1,244 @@
+#include "grammar.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "trace.h"
+using namespace std;
+
+namespace jsontoxml {
+
+static string trimProduction(const string &str) {
+    size_t start = str.find_first_not_of(" \t\r");
+    if (start == string::npos) return "";
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(start, end - start + 1);
+}
+bool isNonTerminal(const string &symbol) {
+    return isupper(symbol[0]);
+}
+bool readGrammar(const string &filename, Grammar &grammar) {
+    ifstream file(filename);
+    if (!file) {
+        cerr << "Error: Cannot open " << filename << endl;
+        return false;
+    }
+    grammar = Grammar();
+    string line;
+    int lineCount = 0;
+
+    while (getline(file, line)) {
+        lineCount++;
+        if (lineCount <= 3) {
+            stringstream s(line);
+            string symbol;
+            if (lineCount == 3) {
+                s >> grammar.startsymbol;
+                continue;
+            }
+            while (s >> symbol) {
+                if (lineCount == 1) grammar.terminals.push_back(symbol);
+                else grammar.nonterminals.push_back(symbol);
+            }
+            continue;
+        }
+        if (line.empty()) continue;
+        size_t tabPos = line.find('\t');
+        if (tabPos == string::npos) continue;
+
+        string lhs = line.substr(0, tabPos);
+        lhs.erase(remove(lhs.begin(), lhs.end(), ' '), lhs.end());
+
+        if (grammar.first_lhs.empty()) grammar.first_lhs = lhs;
+
+        string rhs = line.substr(tabPos + 1);
+        istringstream prodStream(rhs);
+        string prod;
+        vector<string> &rules = grammar.production_rules[lhs];
+        while (getline(prodStream, prod, '|')) {
+            istringstream symbolStream(prod);
+            vector<string> production;
+            string symbol;
+            while (symbolStream >> symbol) {
+                production.push_back(symbol);
+            }
+            grammar.productions[lhs].push_back(production);
+            rules.push_back(trimProduction(prod));
+        }
+    }
+    return true;
+}
+
+// FIRST of one symbol; `firstSets` caches the nonterminals' sets as they are computed
+static set<string> firstOf(const Grammar &grammar, SymbolSets &firstSets, const string &symbol) {
+    if (!isNonTerminal(symbol)) return {symbol};
+
+    if (!firstSets[symbol].empty()) return firstSets[symbol];
+
+    auto rules = grammar.productions.find(symbol);
+    if (rules == grammar.productions.end()) return firstSets[symbol];
+    for (const auto &prod : rules->second) {
+        for (const string &sym : prod) {
+            set<string> temp = firstOf(grammar, firstSets, sym);
+            firstSets[symbol].insert(temp.begin(), temp.end());
+            if (temp.find("e") == temp.end()) break;
+            else if (sym == prod.back()) firstSets[symbol].insert("e");
+        }
+    }
+    return firstSets[symbol];
+}
+set<string> first(const SymbolSets &firstSets, const vector<string> &symbols) {
+    set<string> result;
+    for (const string &symbol : symbols) {
+        set<string> temp;
+        if (!isNonTerminal(symbol)) {
+            temp = {symbol};
+        } else {
+            auto found = firstSets.find(symbol);
+            if (found != firstSets.end()) temp = found->second;
+        }
+        result.insert(temp.begin(), temp.end());
+        if (temp.find("e") == temp.end()) break;
+        else if (symbol == symbols.back()) result.insert("e");
+    }
+    return result;
+}
+SymbolSets computeFirst(const Grammar &grammar) {
+    SymbolSets firstSets;
+    for (const auto &entry : grammar.productions) firstOf(grammar, firstSets, entry.first);
+    return firstSets;
+}
+SymbolSets computeFollow(const Grammar &grammar, const SymbolSets &firstSets) {
+    SymbolSets followSets;
+    followSets[grammar.first_lhs].insert("$");
+
+    bool updated = true;
+    while (updated) {
+        updated = false;
+
+        for (const auto &rule : grammar.productions) {
+            const string &head = rule.first;
+
+            for (const auto &prod : rule.second) {
+                for (size_t i = 0; i < prod.size(); ++i) {
+                    const string &B = prod[i];
+                    if (!isNonTerminal(B)) continue;
+
+                    if (i + 1 < prod.size()) {
+                        vector<string> beta(prod.begin() + i + 1, prod.end());
+                        set<string> firstBeta = first(firstSets, beta);
+
+                        size_t before = followSets[B].size();
+                        for (const string &sym : firstBeta) {
+                            if (sym != "e") followSets[B].insert(sym);
+                        }
+
+                        if (firstBeta.count("e")) {
+                            followSets[B].insert(followSets[head].begin(), followSets[head].end());
+                        }
+
+                        if (followSets[B].size() > before) updated = true;
+                    } else {
+                        size_t before = followSets[B].size();
+                        followSets[B].insert(followSets[head].begin(), followSets[head].end());
+                        if (followSets[B].size() > before) updated = true;
+                    }
+                }
+            }
+        }
+    }
+    return followSets;
+}
+void writeSetToFile(const string &filename, const SymbolSets &sets) {
+    ofstream out(filename);
+    for (const auto &entry : sets) {
+        out << entry.first << " ";
+        for (const auto &sym : entry.second) {
+            out << sym << " ";
+        }
+        out << endl;
+    }
+}
+
+// parsing table
+ParsingTable::ParsingTable(const Grammar& grm, const SymbolSets& fst, const SymbolSets& flo)
+    : grammar(grm), first(fst), follow(flo) {}
+
+const set<string>& ParsingTable::lookup(const SymbolSets& sets, const string& nonterminal) {
+    static const set<string> none;
+    auto found = sets.find(nonterminal);
+    return found == sets.end() ? none : found->second;
+}
+
+void ParsingTable::build_parsing_table() {
+    predictive_table.clear();
+    for (const auto& [nonterminal, rules] : grammar.production_rules) {
+        for (const string& rule : rules) {
+            vector<string> symbols = split_rule(rule);
+            if (symbols.empty()) {
+                continue;
+            }
+
+            string symbol = symbols[0];
+            if (find(grammar.terminals.begin(), grammar.terminals.end(), symbol) != grammar.terminals.end()) {
+                predictive_table.push_back({ nonterminal, symbol, rule });
+                JTX_TRACE(TRACE_DEBUG, EV_TABLE_ENTRY, nonterminal + "," + symbol, rule, 0);
+            }
+            else if (find(grammar.nonterminals.begin(), grammar.nonterminals.end(), symbol) != grammar.nonterminals.end()) {
+                for (const string& fst : lookup(first, symbol)) {
+                    if (fst != "e") {
+                        predictive_table.push_back({ nonterminal, fst, rule });
+                        JTX_TRACE(TRACE_DEBUG, EV_TABLE_ENTRY, nonterminal + "," + fst, rule, 0);
+                    }
+                    else {
+                        for (const string& flo : lookup(follow, symbol)) {
+                            predictive_table.push_back({ nonterminal, flo, rule });
+                            JTX_TRACE(TRACE_DEBUG, EV_TABLE_ENTRY, nonterminal + "," + flo, rule, 0);
+                        }
+                    }
+                }
+            }
+            else if (symbol == "e") {
+                for (const string& flo : lookup(follow, nonterminal)) {
+                    predictive_table.push_back({ nonterminal, flo, rule });
+                    JTX_TRACE(TRACE_DEBUG, EV_TABLE_ENTRY, nonterminal + "," + flo, rule, 0);
+                }
+            }
+        }
+    }
+    JTX_TRACE(TRACE_INFO, EV_TABLE_BUILT, "", "", predictive_table.size());
+}
+
+void ParsingTable::write_parsing_table(string output) {
+    ofstream predfile(output);
+    if (!predfile) {
+        cerr << "Error opening output file!" << endl;
+        return;
+    }
+    predfile << grammar.startsymbol << endl;
+    for (const auto& entry : predictive_table) {
+        predfile << entry.nonterminal << " " << entry.first << "\t" << entry.rule << endl;
+    }
+
+    predfile.close();
+}
+
+vector<string> ParsingTable::split_rule(const string& rule) {
+    stringstream ss(rule);
+    string sym;
+    vector<string> result;
+    while (ss >> sym) result.push_back(remove_spaces(sym));
+    return result;
+}
+
+string ParsingTable::remove_spaces(const string& str) {
+    string result = "";
+    for (char c : str) {
+        if (c != ' ') result += c;
+    }
+    return result;
+}
+
+}
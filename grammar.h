@@ -0,0 +1,62 @@
+#ifndef JSONTOXML_GRAMMAR_H
+#define JSONTOXML_GRAMMAR_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace jsontoxml {
+
+struct Grammar {
+    std::vector<std::string> terminals;
+    std::vector<std::string> nonterminals;
+    std::string startsymbol;
+    std::map<std::string, std::vector<std::string>> production_rules;
+    // the same productions split into symbols, for FIRST and FOLLOW
+    std::map<std::string, std::vector<std::vector<std::string>>> productions;
+    // left-hand side of the first production; FOLLOW puts $ after it
+    std::string first_lhs;
+};
+struct Predictive_table {
+    std::string nonterminal;
+    std::string first;
+    std::string rule;
+};
+// FIRST or FOLLOW set of every nonterminal
+typedef std::map<std::string, std::set<std::string>> SymbolSets;
+
+bool isNonTerminal(const std::string &symbol);
+// Reads grammar.txt once: the terminal, nonterminal and start symbol lines
+// and the productions all go into `grammar`, which is reset first.
+bool readGrammar(const std::string &filename, Grammar &grammar);
+// FIRST of a symbol string, given the FIRST sets of the nonterminals.
+std::set<std::string> first(const SymbolSets &firstSets, const std::vector<std::string> &symbols);
+SymbolSets computeFirst(const Grammar &grammar);
+SymbolSets computeFollow(const Grammar &grammar, const SymbolSets &firstSets);
+void writeSetToFile(const std::string &filename, const SymbolSets &sets);
+
+// parsing table, built from a grammar and sets the caller keeps alive
+class ParsingTable {
+private:
+    const Grammar& grammar;
+    const SymbolSets& first;
+    const SymbolSets& follow;
+    std::vector<Predictive_table> predictive_table;
+
+    static const std::set<std::string>& lookup(const SymbolSets& sets, const std::string& nonterminal);
+
+public:
+    ParsingTable(const Grammar& grm, const SymbolSets& fst, const SymbolSets& flo);
+
+    void build_parsing_table();
+    void write_parsing_table(std::string output);
+    const Grammar& get_grammar() const { return grammar; }
+    const std::vector<Predictive_table>& get_table() const { return predictive_table; }
+    std::vector<std::string> split_rule(const std::string& rule);
+    std::string remove_spaces(const std::string& str);
+};
+
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include "incremental.h"
+
+#include <algorithm>
+#include <cctype>
+#include <istream>
+
+#include "converter.h"
+using namespace std;
+
+namespace jsontoxml {
+
+typedef IncrementalSession::Span Span;
+
+static string_view childTag(const Span& parent) {
+    return parent.kind == IncrementalSession::KEY ? string_view(parent.tag)
+         : parent.kind == IncrementalSession::INDEX ? string_view("item") : string_view("root");
+}
+
+namespace {
+// Builds the Span tree of one conversion under `top`, which the caller has
+// already seeded. Offsets arrive relative to the converted buffer; each span
+// keeps them absolute until it is left, when its children are made relative
+// to it.
+class SpanBuilder : public ConvertObserver {
+public:
+    SpanBuilder(Span& top, const string& text, size_t json_base, size_t xml_base)
+        : text(text), json_base(json_base), xml_base(xml_base) {
+        stack.push_back(&top);
+    }
+
+    void enter_root(uint64_t xml_offset, size_t json_offset) override {
+        Span& top = *stack.back();
+        top.json_begin = value_begin(json_offset);
+        top.xml_begin = xml_base + xml_offset;
+    }
+    void enter_key(string_view key, uint64_t xml_offset, size_t json_offset) override {
+        push(IncrementalSession::KEY, key, xml_offset, json_offset);
+    }
+    void enter_index(size_t, uint64_t xml_offset, size_t json_offset) override {
+        push(IncrementalSession::INDEX, childTag(*stack.back()), xml_offset, json_offset);
+    }
+    void leave(uint64_t xml_offset, size_t json_offset) override {
+        Span& s = *stack.back();
+        s.json_size = json_base + json_offset - s.json_begin;
+        s.xml_size = xml_base + xml_offset - s.xml_begin;
+        for (Span& child : s.children) {
+            child.json_begin -= s.json_begin;
+            child.xml_begin -= s.xml_begin;
+        }
+        stack.pop_back();
+    }
+
+private:
+    size_t value_begin(size_t json_offset) const {
+        size_t begin = json_base + json_offset;
+        while (begin < text.size() && isspace((unsigned char)text[begin])) begin++;
+        return begin;
+    }
+    void push(IncrementalSession::Kind kind, string_view tag, uint64_t xml_offset, size_t json_offset) {
+        Span& parent = *stack.back();
+        parent.children.emplace_back();
+        Span& s = parent.children.back();
+        s.json_begin = value_begin(json_offset);
+        s.xml_begin = xml_base + xml_offset;
+        s.level = parent.level + 1;
+        s.kind = kind;
+        s.tag = string(tag);
+        stack.push_back(&s);
+    }
+
+    const string& text;
+    size_t json_base, xml_base;
+    vector<Span*> stack;
+};
+}
+
+bool IncrementalSession::load(string_view json) {
+    text.assign(json.data(), json.size());
+    return convert_all();
+}
+
+TokenList IncrementalSession::tokens() const {
+    TokenList list;
+    list.reserve(before.size() + after.size());
+    auto add = [&](size_t offset, const TapeToken& t) {
+        Token token;
+        token.name = names[t.name];
+        token.value = string_view(text).substr(offset, t.length);
+        token.offset = offset;
+        list.push_back(move(token));
+    };
+    for (const TapeToken& t : before) add(t.offset, t);
+    for (auto it = after.rbegin(); it != after.rend(); ++it) add(tape_size - it->offset, *it);
+    return list;
+}
+
+uint32_t IncrementalSession::intern(string_view name) {
+    for (size_t i = 0; i < names.size(); i++)
+        if (names[i] == name) return uint32_t(i);
+    names.emplace_back(name);
+    return uint32_t(names.size() - 1);
+}
+
+void IncrementalSession::push_tokens(const TokenList& tokens, size_t base) {
+    for (const Token& t : tokens) {
+        TapeToken tape;
+        tape.offset = base + t.offset;
+        tape.length = uint32_t(t.value.size());
+        tape.name = intern(t.name);
+        before.push_back(tape);
+    }
+}
+
+// Moves the gap so that exactly the tokens starting before `pos` are in
+// `before`.
+void IncrementalSession::move_gap(size_t pos) {
+    while (!before.empty() && before.back().offset >= pos) {
+        TapeToken t = before.back();
+        before.pop_back();
+        t.offset = tape_size - t.offset;
+        after.push_back(t);
+    }
+    while (!after.empty() && tape_size - after.back().offset < pos) {
+        TapeToken t = after.back();
+        after.pop_back();
+        t.offset = tape_size - t.offset;
+        before.push_back(t);
+    }
+}
+
+bool IncrementalSession::convert_all() {
+    dirty = true;
+    tree = Span();
+    before.clear();
+    after.clear();
+    TokenList tokens;
+    if (!context.validate(text.data(), text.size(), tokens)) {
+        failure = context.error();
+        return false;
+    }
+    push_tokens(tokens, 0);
+    tape_size = text.size();
+
+    XmlOutput xml;
+    tree.tag = "root";
+    SpanBuilder builder(tree, text, 0, 0);
+    xml.observer = &builder;
+    InputBuffer input(text.data(), text.size());
+    istream ss(&input);
+    parseJSONtoXML(ss, xml, 0, "root");
+
+    splice.offset = 0;
+    splice.removed = output.size();
+    splice.inserted = xml.data.size();
+    output.assign(xml.data.data(), xml.data.size());
+    failure.clear();
+    dirty = false;
+    return true;
+}
+
+bool IncrementalSession::edit(size_t offset, size_t removed, string_view inserted) {
+    if (offset > text.size() || removed > text.size() - offset) {
+        failure = "Error: Edit range is outside the document";
+        return false;
+    }
+    text.replace(offset, removed, inserted.data(), inserted.size());
+    if (dirty) return convert_all();
+
+    // Descend while the child holding the edit is a container whose brackets
+    // the edit leaves alone. The bytes before the edit are unchanged, so the
+    // child starts can still be read from the text.
+    size_t end = offset + removed;
+    vector<PathStep> path;
+    Span* span = &tree;
+    size_t json_at = tree.json_begin, xml_at = tree.xml_begin;
+    for (;;) {
+        if (offset <= json_at) break;
+        vector<Span>& children = span->children;
+        auto next = upper_bound(children.begin(), children.end(), offset - json_at,
+                                [](size_t pos, const Span& s) { return pos < s.json_begin; });
+        if (next == children.begin()) break;
+        Span& child = *(next - 1);
+        size_t begin = json_at + child.json_begin;
+        char open = text[begin];
+        if (!(open == '{' || open == '[') || begin >= offset || end >= begin + child.json_size) break;
+        path.push_back({span, size_t(next - 1 - children.begin())});
+        span = &child;
+        json_at = begin;
+        xml_at += child.xml_begin;
+    }
+    if (path.empty()) return convert_all();
+    return reconvert(path, json_at, xml_at, offset, offset + inserted.size(),
+                     (long long)inserted.size() - (long long)removed);
+}
+
+// Rescans the lines from `offset` to `end` (new coordinates), revalidates the
+// container at the end of `path`, which starts at `json_at` and `xml_at`, and
+// splices its new XML and spans in.
+bool IncrementalSession::reconvert(vector<PathStep>& path, size_t json_at, size_t xml_at,
+                                   size_t offset, size_t end, long long delta) {
+    Span& old = path.back().span->children[path.back().child];
+    size_t json_end = size_t((long long)(json_at + old.json_size) + delta);
+
+    // No token but whitespace can hold a newline, and the container's
+    // brackets are token boundaries, so rescanning whole lines clipped to it
+    // is exact.
+    string_view container(text.data() + json_at, json_end - json_at);
+    size_t line_begin = container.rfind('\n', offset - 1 - json_at);
+    size_t window = line_begin == string::npos ? json_at : json_at + line_begin + 1;
+    size_t line_end = container.find('\n', end - json_at);
+    size_t window_end = line_end == string::npos ? json_end : json_at + line_end + 1;
+
+    move_gap(window);
+    size_t old_window_end = size_t((long long)window_end - delta);
+    while (!after.empty() && tape_size - after.back().offset < old_window_end) after.pop_back();
+    tape_size = text.size();
+
+    arena.reset();
+    TokenList fresh(&arena);
+    if (!context.scan(text.data() + window, window_end - window, fresh)) {
+        failure = context.error();
+        dirty = true;
+        return false;
+    }
+    push_tokens(fresh, window);
+
+    // A container is an Object or Array whichever side of the grammar it sits
+    // on, so checking it as a document of its own checks it in place.
+    move_gap(json_end);
+    auto first = lower_bound(before.begin(), before.end(), json_at,
+                             [](const TapeToken& t, size_t pos) { return t.offset < pos; });
+    TokenList tokens(&arena);
+    tokens.reserve(before.end() - first);
+    for (auto it = first; it != before.end(); ++it) {
+        tokens.emplace_back();
+        tokens.back().name = names[it->name];
+        tokens.back().offset = it->offset;
+    }
+    if (!context.validate(tokens)) {
+        failure = context.error();
+        dirty = true;
+        return false;
+    }
+
+    Span span;
+    span.json_begin = json_at;
+    span.xml_begin = xml_at;
+    span.level = old.level;
+    span.kind = old.kind;
+    span.tag = old.tag;
+    const char* sub = text.data() + json_at;
+    size_t sublen = json_end - json_at;
+    XmlOutput xml;
+    SpanBuilder builder(span, text, json_at, xml_at);
+    xml.observer = &builder;
+    InputBuffer input(sub, sublen);
+    istream ss(&input);
+    if (old.kind == INDEX) parseArrayElement(ss, xml, old.level - 1, old.tag);
+    else parseValue(ss, xml, old.level, old.tag);
+    builder.leave(xml.offset(), sublen);
+
+    long long xml_delta = (long long)xml.data.size() - (long long)old.xml_size;
+    output.replace(xml_at, old.xml_size, xml.data.data(), xml.data.size());
+    splice.offset = xml_at;
+    splice.removed = old.xml_size;
+    splice.inserted = xml.data.size();
+
+    span.json_begin = old.json_begin;
+    span.xml_begin = old.xml_begin;
+    old = move(span);
+
+    // every ancestor grows, and the values after it within each one move
+    for (PathStep& step : path) {
+        vector<Span>& children = step.span->children;
+        for (size_t i = step.child + 1; i < children.size(); i++) {
+            children[i].json_begin += delta;
+            children[i].xml_begin += xml_delta;
+        }
+        step.span->json_size += delta;
+        step.span->xml_size += xml_delta;
+    }
+
+    failure.clear();
+    return true;
+}
+
+}
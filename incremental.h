@@ -0,0 +1,96 @@
+#ifndef JSONTOXML_INCREMENTAL_H
+#define JSONTOXML_INCREMENTAL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "jsontoxml.h"
+#include "memory.h"
+
+namespace jsontoxml {
+
+// Keeps a converted document together with its token tape and a tree of
+// the XML span every JSON value became, so that an edit only rescans the
+// lines it touched, revalidates and reconverts the smallest object or array
+// enclosing it, and splices the result into the previous output.
+// Options::select is not applied; the XML is always the full conversion.
+class IncrementalSession {
+public:
+    // Where the last load() or edit() changed the XML: `removed` bytes at
+    // `offset` were replaced by `inserted` bytes.
+    struct Splice {
+        size_t offset = 0;
+        size_t removed = 0;
+        size_t inserted = 0;
+    };
+
+    enum Kind { ROOT, KEY, INDEX };
+    // One JSON value and the XML it became. Offsets are relative to the
+    // enclosing value's, so an edit only moves the values that follow it
+    // within each of its ancestors.
+    struct Span {
+        size_t json_begin = 0, json_size = 0;
+        size_t xml_begin = 0, xml_size = 0;
+        int level = 0;    // indent level the value is written at
+        Kind kind = ROOT;
+        std::string tag;  // KEY: the key; INDEX: the array's tag; ROOT: "root"
+        std::vector<Span> children;
+    };
+
+    explicit IncrementalSession(Context& context) : context(context) {}
+
+    // Converts the whole document.
+    bool load(std::string_view json);
+    // Replaces `removed` bytes at `offset` with `inserted`. Returns false when
+    // the edited document is rejected; xml() then still holds the last good
+    // output, and the next edit converts the whole document again.
+    bool edit(size_t offset, size_t removed, std::string_view inserted);
+
+    const std::string& json() const { return text; }
+    const std::string& xml() const { return output; }
+    const Span& root() const { return tree; }
+    TokenList tokens() const;
+    const Splice& last_splice() const { return splice; }
+    const std::string& error() const { return failure; }
+
+private:
+    // The token tape is a gap buffer: `before` holds the tokens ahead of the
+    // gap in order, with absolute offsets; `after` holds the rest in reverse
+    // order, counted back from the end of the document, so an edit at the gap
+    // leaves every token behind it untouched.
+    struct TapeToken {
+        size_t offset;
+        uint32_t length;
+        uint32_t name;
+    };
+
+    struct PathStep {
+        Span* span;
+        size_t child;
+    };
+
+    bool convert_all();
+    bool reconvert(std::vector<PathStep>& path, size_t json_at, size_t xml_at,
+                   size_t offset, size_t end, long long delta);
+    void move_gap(size_t pos);
+    uint32_t intern(std::string_view name);
+    void push_tokens(const TokenList& tokens, size_t base);
+
+    Context& context;
+    std::string failure;
+    std::string text;
+    std::string output;
+    Span tree;
+    std::vector<TapeToken> before, after;
+    size_t tape_size = 0; // document size the `after` offsets count back from
+    std::vector<std::string> names;
+    DocumentArena arena;
+    Splice splice;
+    bool dirty = true;
+};
+
+}
+
+#endif
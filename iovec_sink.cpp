@@ -0,0 +1,93 @@
+#include "iovec_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+static const size_t BLOCK_SIZE = 64 * 1024;
+
+IovecSink::IovecSink(vector<int> fds, size_t batch_bytes) : fds(move(fds)), batch_bytes(batch_bytes) {}
+
+void IovecSink::queue(const char* data, size_t len) {
+    pieces.push_back({data, len});
+    queued += len;
+    total += len;
+    if (queued >= batch_bytes) flush();
+}
+
+void IovecSink::write(const char* data, size_t len) {
+    if (len == 0 || !failure.empty()) return;
+    if (block == blocks.size() || blocks[block].capacity() - blocks[block].size() < len) {
+        if (block < blocks.size() && !blocks[block].empty()) block++;
+        if (block == blocks.size()) blocks.emplace_back();
+        if (blocks[block].capacity() < len) blocks[block].reserve(max(BLOCK_SIZE, len));
+    }
+    vector<char>& current = blocks[block];
+    const char* at = current.data() + current.size();
+    current.insert(current.end(), data, data + len);
+    // consecutive fragments in one block go out as one iovec
+    if (!pieces.empty() && pieces.back().data + pieces.back().len == at) {
+        pieces.back().len += len;
+        queued += len;
+        total += len;
+        if (queued >= batch_bytes) flush();
+        return;
+    }
+    queue(at, len);
+}
+
+void IovecSink::write_reference(const char* data, size_t len) {
+    if (len == 0 || !failure.empty()) return;
+    referenced += len;
+    queue(data, len);
+}
+
+bool IovecSink::flush() {
+    if (!failure.empty()) return false;
+    for (int fd : fds) {
+#if defined(__unix__) || defined(__APPLE__)
+        vector<iovec> iov(pieces.size());
+        for (size_t i = 0; i < pieces.size(); i++) iov[i] = {const_cast<char*>(pieces[i].data), pieces[i].len};
+        size_t i = 0;
+        while (i < iov.size()) {
+            ssize_t n = writev(fd, &iov[i], int(min(iov.size() - i, size_t(IOV_MAX))));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                failure = string("Error: Cannot write output: ") + strerror(errno);
+                return false;
+            }
+            // a short write leaves the rest of the batch, maybe mid-iovec
+            size_t done = size_t(n);
+            while (i < iov.size() && done >= iov[i].iov_len) done -= iov[i++].iov_len;
+            if (done) {
+                iov[i].iov_base = (char*)iov[i].iov_base + done;
+                iov[i].iov_len -= done;
+            }
+        }
+#else
+        for (const Piece& piece : pieces) {
+            if (_write(fd, piece.data, unsigned(piece.len)) != int(piece.len)) {
+                failure = string("Error: Cannot write output: ") + strerror(errno);
+                return false;
+            }
+        }
+#endif
+    }
+    pieces.clear();
+    queued = 0;
+    for (vector<char>& b : blocks) b.clear();
+    block = 0;
+    return true;
+}
+
+}
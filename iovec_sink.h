@@ -0,0 +1,54 @@
+#ifndef JSONTOXML_IOVEC_SINK_H
+#define JSONTOXML_IOVEC_SINK_H
+
+#include <string>
+#include <vector>
+
+#include "jsontoxml.h"
+
+namespace jsontoxml {
+
+// Gathers the output as a rope of iovecs and writes it with writev(): the
+// generated tag fragments are copied into blocks the sink owns, while the
+// input spans handed to write_reference() are queued as they are, so string
+// values go from the (mapped) input to the kernel without a copy in user
+// space. Every `batch_bytes` of queued output is written to each of `fds`
+// in turn; the referenced input must stay valid until then.
+class IovecSink : public Sink {
+public:
+    explicit IovecSink(std::vector<int> fds, size_t batch_bytes = 4 * 1024 * 1024);
+    IovecSink(const IovecSink&) = delete;
+    IovecSink& operator=(const IovecSink&) = delete;
+
+    void write(const char* data, size_t len) override;
+    bool takes_references() const override { return true; }
+    void write_reference(const char* data, size_t len) override;
+    // Writes whatever is still queued. False once any write has failed;
+    // error() then says why and later output is dropped.
+    bool flush();
+    const std::string& error() const { return failure; }
+    // Output bytes so far, and how many of them were sent by reference.
+    size_t bytes() const { return total; }
+    size_t referenced_bytes() const { return referenced; }
+
+private:
+    struct Piece {
+        const char* data;
+        size_t len;
+    };
+    void queue(const char* data, size_t len);
+
+    std::vector<int> fds;
+    size_t batch_bytes;
+    std::vector<Piece> pieces;
+    size_t queued = 0;
+    // generated bytes; a block is never reallocated while pieces point into it
+    std::vector<std::vector<char>> blocks;
+    size_t block = 0;
+    size_t total = 0, referenced = 0;
+    std::string failure;
+};
+
+}
+
+#endif
@@ -0,0 +1,381 @@
+#include "jsontoxml.h"
+
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <istream>
+#include <iostream>
+#include <sstream>
+
+#include "codegen.h"
+#include "converter.h"
+#include "grammar.h"
+#include "line_index.h"
+#include "memory.h"
+#include "parser.h"
+#include "pipeline.h"
+#include "probes.h"
+#include "projection.h"
+#include "rd_parser.h"
+#include "scanner.h"
+#include "shape.h"
+#include "xml_index.h"
+using namespace std;
+
+namespace jsontoxml {
+
+struct ContextState {
+    explicit ContextState(const Options& options) : options(options), arena(options.memory) {}
+    Options options;
+    vector<TokenRule> rules;
+    LL1_parser parser;
+    DocumentArena arena;
+    // Seed for cache keys, derived from the token and grammar files and the selection.
+    uint64_t cache_seed = 0;
+    string error;
+    bool ok = false;
+};
+
+Context::Context(const Options& options) : state(new ContextState(options)) {
+    Stats* stats = options.stats;
+    // built per Context, so Contexts can be constructed on several threads at once
+    Grammar grammar;
+    SymbolSets firstSets, followSets;
+    {
+        StageTimer timer(stats, "load");
+        state->rules = loadTokenRules(options.tokens_file);
+        if (state->rules.empty()) {
+            state->error = "Error: Cannot load token rules from " + options.tokens_file;
+            return;
+        }
+        if (!readGrammar(options.grammar_file, grammar)) {
+            state->error = "Error: Cannot open " + options.grammar_file;
+            return;
+        }
+    }
+    {
+        StageTimer timer(stats, "first_follow");
+        firstSets = computeFirst(grammar);
+        followSets = computeFollow(grammar, firstSets);
+    }
+
+    ParsingTable tab1(grammar, firstSets, followSets);
+    {
+        StageTimer timer(stats, "table");
+        tab1.build_parsing_table();
+    }
+
+    if (options.dump_artifacts) {
+        writeSetToFile("first.txt", firstSets);
+        writeSetToFile("follow.txt", followSets);
+        tab1.write_parsing_table("parse_table.txt");
+    }
+
+    state->parser = LL1_parser(tab1.get_grammar(), tab1.get_table(), followSets);
+    if (!state->parser.is_loaded()) {
+        state->error = "Error: Conflict in parsing table";
+        return;
+    }
+    if (options.generated_parser &&
+        grammarSignature(tab1.get_grammar().startsymbol, tab1.get_table()) != rdGrammarSignature) {
+        state->error = "Error: " + options.grammar_file + " does not match the generated parser; "
+                       "regenerate rd_parser.cpp with --gen-parser";
+        return;
+    }
+    if (options.cache) {
+        stringstream files;
+        files << ifstream(options.tokens_file).rdbuf() << '\0' << ifstream(options.grammar_file).rdbuf();
+        if (options.select) files << '\0' << options.select->text();
+        string text = files.str();
+        CacheKey fingerprint = hashBytes(text.data(), text.size());
+        state->cache_seed = fingerprint.lo ^ fingerprint.hi;
+    }
+    state->ok = true;
+}
+
+Context::~Context() = default;
+
+bool Context::ok() const {
+    return state->ok;
+}
+
+const string& Context::error() const {
+    return state->error;
+}
+
+namespace {
+class CountingSink : public Sink {
+public:
+    explicit CountingSink(Sink& out) : out(out) {}
+    void write(const char* data, size_t len) override {
+        bytes += len;
+        out.write(data, len);
+    }
+    bool takes_references() const override { return out.takes_references(); }
+    void write_reference(const char* data, size_t len) override {
+        bytes += len;
+        out.write_reference(data, len);
+    }
+    size_t bytes = 0;
+private:
+    Sink& out;
+};
+
+// Forwards to `out` and keeps a copy for the result cache.
+class CapturingSink : public Sink {
+public:
+    explicit CapturingSink(Sink& out) : out(out) {}
+    void write(const char* data, size_t len) override {
+        str.append(data, len);
+        out.write(data, len);
+    }
+    bool takes_references() const override { return out.takes_references(); }
+    void write_reference(const char* data, size_t len) override {
+        str.append(data, len);
+        out.write_reference(data, len);
+    }
+    string str;
+private:
+    Sink& out;
+};
+}
+
+bool Context::convert(const char* in, size_t len, Sink& out) {
+    JTX_PROBE1(doc_start, len);
+    auto start = chrono::steady_clock::now();
+    CountingSink counted(out);
+    ResultCache* cache = state->options.cache;
+    bool ok;
+    if (cache && state->ok && !state->options.index) {
+        CacheKey key;
+        string xml;
+        bool hit;
+        {
+            StageTimer timer(state->options.stats, "cache_lookup", len);
+            key = hashBytes(in, len, state->cache_seed);
+            hit = cache->lookup(key, xml);
+        }
+        if (hit) {
+            state->error.clear();
+            counted.write(xml.data(), xml.size());
+            ok = true;
+        } else {
+            CapturingSink capture(counted);
+            ok = convert_document(in, len, capture);
+            if (ok) cache->store(key, capture.str);
+        }
+    } else {
+        ok = convert_document(in, len, counted);
+    }
+    if (!ok && state->ok && state->options.diagnostics) diagnose(in, len, *state->options.diagnostics);
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+    JTX_PROBE4(doc_end, len, counted.bytes, elapsed.count(), ok);
+    return ok;
+}
+
+bool Context::validate(const char* in, size_t len, TokenList& tokens) {
+    return scan(in, len, tokens) && validate(tokens);
+}
+
+bool Context::scan(const char* in, size_t len, TokenList& tokens) {
+    if (!state->ok) return false;
+    state->error.clear();
+    tokens.clear();
+    return scanInput(in, len, state->rules, tokens, state->error);
+}
+
+bool Context::validate(const TokenList& tokens) {
+    if (!state->ok) return false;
+    state->error.clear();
+    bool accepted = state->options.generated_parser ? rdParse(tokens) : state->parser.check_parser(tokens);
+    if (!accepted) {
+        state->error = "Error: Input rejected by the LL(1) parser";
+        return false;
+    }
+    return true;
+}
+
+bool Context::validate(const char* in, size_t len) {
+    if (!state->ok) return false;
+    state->error.clear();
+    state->arena.reset();
+    StageTimer timer(state->options.stats, "parse", len);
+    string scanError;
+    Generator<Token> tokens = scanTokens(in, len, state->rules, scanError, &state->arena);
+    bool accepted = state->options.generated_parser ? rdParse(tokens) : state->parser.check_parser(tokens);
+    if (!scanError.empty()) {
+        state->error = scanError;
+        return false;
+    }
+    if (!accepted) {
+        state->error = "Error: Input rejected by the LL(1) parser";
+        return false;
+    }
+    return true;
+}
+
+bool Context::diagnose(const char* in, size_t len, Diagnostics& diagnostics) {
+    if (!state->ok) return false;
+    StageTimer timer(state->options.stats, "diagnose", len);
+    state->arena.reset();
+    string scanError;
+    size_t first = diagnostics.list.size();
+    Generator<Token> tokens = scanTokens(in, len, state->rules, scanError, &state->arena, &diagnostics);
+    bool parsed = state->parser.check_parser(tokens, diagnostics);
+    LineIndex lines(in, len);
+    for (size_t i = first; i < diagnostics.list.size(); i++) {
+        Diagnostic& diagnostic = diagnostics.list[i];
+        lines.locate(diagnostic.offset, diagnostic.line, diagnostic.column);
+    }
+    return parsed && scanError.empty();
+}
+
+bool Context::convert_document(const char* in, size_t len, Sink& out) {
+    if (!state->ok) return false;
+    state->error.clear();
+    state->arena.reset();
+    if (state->options.index) state->options.index->clear();
+    Stats* stats = state->options.stats;
+
+    if (state->options.pipelined || state->options.streaming) {
+        StageTimer timer(stats, "convert", len);
+        bool converted = state->options.pipelined
+            ? convertPipelined(in, len, state->rules, state->parser, state->options, out, state->error)
+            : convertStreaming(in, len, state->rules, state->parser, state->options, out, state->error);
+        if (stats && state->parser.get_peak_depth() > stats->peak_stack_depth) {
+            stats->peak_stack_depth = state->parser.get_peak_depth();
+        }
+        return converted;
+    }
+
+    bool accepted;
+    if (state->options.dump_artifacts || stats) {
+        TokenList tokens(&state->arena);
+        bool scanned;
+        {
+            StageTimer timer(stats, "scan", len);
+            scanned = scanInput(in, len, state->rules, tokens, state->error);
+        }
+        if (stats) stats->tokens += tokens.size();
+        if (state->options.dump_artifacts) {
+            writeTokensToFile("scanner_output.txt", tokens);
+        }
+        if (!scanned) return false;
+        {
+            StageTimer timer(stats, "validate");
+            accepted = state->options.generated_parser ? rdParse(tokens) : state->parser.check_parser(tokens);
+        }
+        if (stats && state->parser.get_peak_depth() > stats->peak_stack_depth) {
+            stats->peak_stack_depth = state->parser.get_peak_depth();
+        }
+    } else {
+        StageTimer timer(stats, "parse", len);
+        string scanError;
+        Generator<Token> tokens = scanTokens(in, len, state->rules, scanError, &state->arena);
+        accepted = state->options.generated_parser ? rdParse(tokens) : state->parser.check_parser(tokens);
+        if (!scanError.empty()) {
+            state->error = scanError;
+            return false;
+        }
+    }
+    if (!accepted) {
+        state->error = "Error: Input rejected by the LL(1) parser";
+        return false;
+    }
+
+    StageTimer timer(stats, "emit", len);
+    InputBuffer input(in, len);
+    istream buffer(&input);
+    XmlOutput xml(&state->arena);
+    xml.observer = state->options.index;
+    if (out.takes_references()) {
+        // the generated bytes go out as they are written, string values by reference
+        xml.flush = [&out](pmr::string& data) {
+            out.write(data.data(), data.size());
+            data.clear();
+        };
+        xml.reference = [&out](const char* data, size_t len) { out.write_reference(data, len); };
+    }
+    if (state->options.select) projectJSONtoXML(buffer, xml, *state->options.select, 0, "root");
+    else if (state->options.shape && !xml.observer) state->options.shape->convert(in, len, xml);
+    else parseJSONtoXML(buffer, xml, 0, "root");
+    timer.bytes_out = xml.offset();
+    out.write(xml.data.data(), xml.data.size());
+    return true;
+}
+
+bool convert(const char* in, size_t len, Sink& out) {
+    Context context;
+    return context.convert(in, len, out);
+}
+
+}
+
+// C interface. No exception may cross it: a failure that throws, such as
+// std::regex_error from a bad tokens file or std::bad_alloc, is reported
+// like any other, with the message kept for jtx_last_error().
+struct jtx_context {
+    jsontoxml::Context context;
+    string error; // set when the last jtx_convert() threw
+    explicit jtx_context(const jsontoxml::Options& options) : context(options) {}
+};
+
+namespace {
+class CallbackSink : public jsontoxml::Sink {
+public:
+    CallbackSink(jtx_write_fn fn, void* user) : fn(fn), user(user) {}
+    void write(const char* data, size_t len) override { fn(user, data, len); }
+private:
+    jtx_write_fn fn;
+    void* user;
+};
+
+// why the last jtx_context_new() on this thread returned NULL
+thread_local string newError;
+}
+
+extern "C" {
+
+jtx_context* jtx_context_new(const char* tokens_file, const char* grammar_file) {
+    try {
+        jsontoxml::Options options;
+        if (tokens_file) options.tokens_file = tokens_file;
+        if (grammar_file) options.grammar_file = grammar_file;
+        unique_ptr<jtx_context> ctx(new jtx_context(options));
+        if (!ctx->context.ok()) {
+            newError = ctx->context.error();
+            return nullptr;
+        }
+        newError.clear();
+        return ctx.release();
+    } catch (const exception& e) {
+        newError = string("Error: ") + e.what();
+    } catch (...) {
+        newError = "Error: Unknown failure";
+    }
+    return nullptr;
+}
+
+void jtx_context_free(jtx_context* ctx) {
+    delete ctx;
+}
+
+int jtx_convert(jtx_context* ctx, const char* in, size_t len, jtx_write_fn write, void* user) {
+    try {
+        ctx->error.clear();
+        CallbackSink sink(write, user);
+        return ctx->context.convert(in, len, sink) ? 0 : -1;
+    } catch (const exception& e) {
+        ctx->error = string("Error: ") + e.what();
+    } catch (...) {
+        ctx->error = "Error: Unknown failure";
+    }
+    return -1;
+}
+
+const char* jtx_last_error(const jtx_context* ctx) {
+    if (!ctx) return newError.c_str();
+    return ctx->error.empty() ? ctx->context.error().c_str() : ctx->error.c_str();
+}
+
+}
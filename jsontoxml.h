@@ -0,0 +1,154 @@
+#ifndef JSONTOXML_H
+#define JSONTOXML_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+
+#include "result_cache.h"
+#include "scanner.h"
+#include "stats.h"
+
+namespace jsontoxml {
+
+// Receives the generated XML. A conversion may call write() any number of times.
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual void write(const char* data, size_t len) = 0;
+    // Sinks that return true may be handed spans of the input itself through
+    // write_reference() rather than copies of them. The input must then stay
+    // valid until the sink is done with the output.
+    virtual bool takes_references() const { return false; }
+    virtual void write_reference(const char* data, size_t len) { write(data, len); }
+};
+
+class StringSink : public Sink {
+public:
+    std::string str;
+    void write(const char* data, size_t len) override { str.append(data, len); }
+};
+
+class StreamSink : public Sink {
+public:
+    explicit StreamSink(std::ostream& out) : out(out) {}
+    void write(const char* data, size_t len) override { out.write(data, len); }
+private:
+    std::ostream& out;
+};
+
+class PathSelector;
+struct ShapeConverter;
+class XmlIndex;
+
+struct Options {
+    std::string tokens_file = "tokens.txt";
+    std::string grammar_file = "grammar.txt";
+    // Write the intermediate stages (first.txt, follow.txt, parse_table.txt and
+    // scanner_output.txt) to the working directory for debugging.
+    bool dump_artifacts = false;
+    // Overlap scanning, validation, XML generation and writing on separate
+    // threads. The sink is then called from a worker thread and may receive
+    // output for a document that is later rejected.
+    bool pipelined = false;
+    // Single-threaded alternative: tokens are scanned lazily as the parser
+    // pulls them, and each XML element is written as soon as the input it
+    // came from has been validated. Output for a rejected document may again
+    // be partial.
+    bool streaming = false;
+    // When set, per-stage timings, byte counts and allocations are added to it.
+    // Scanning and validation then run one after the other instead of
+    // interleaved so each gets its own figures.
+    Stats* stats = nullptr;
+    // Upstream for the Context's per-document arena, which holds the tokens,
+    // parse state and XML of the document being converted. The arena is
+    // rewound on every convert() call, so after the first few documents it
+    // stops asking this resource for memory. Defaults to new/delete.
+    std::pmr::memory_resource* memory = nullptr;
+    // Accepted results are looked up in and stored to this cache, keyed by
+    // the input bytes, the token and grammar files and the selection. It may be
+    // shared between Contexts on different threads.
+    ResultCache* cache = nullptr;
+    // When set, only the selected subtrees (and the elements leading to them)
+    // are converted; the rest is skipped. The whole document is still validated.
+    const PathSelector* select = nullptr;
+    // Filled with the XML offsets of the last converted document's values.
+    // Conversions with an index bypass the result cache.
+    XmlIndex* index = nullptr;
+    // Validate with the recursive-descent parser generated from grammar.txt
+    // (rd_parser.cpp) instead of interpreting the LL(1) table. The Context
+    // fails to load if grammar_file no longer matches the generated parser.
+    // --pipeline and --stream feed tokens one at a time and always use the table.
+    bool generated_parser = false;
+    // When set, a rejected document is checked again with error recovery and
+    // every problem found, up to the limit, is added here (see diagnose()).
+    Diagnostics* diagnostics = nullptr;
+    // A converter generated for the documents' shape (see shape.h). Its
+    // output is the same as the generic converter's, so it only changes the
+    // speed. Not used with select or index, or with --pipeline and --stream.
+    const ShapeConverter* shape = nullptr;
+};
+
+struct ContextState;
+
+// Holds the token rules and the LL(1) table so they are built once and
+// reused by every convert() call. A Context is not safe to share between
+// threads; give each thread its own.
+class Context {
+public:
+    explicit Context(const Options& options = Options());
+    ~Context();
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    bool ok() const;
+    // Scans, validates and converts `len` bytes of JSON, writing the XML to `out`.
+    // Returns false when the input is rejected; error() then says why.
+    bool convert(const char* in, size_t len, Sink& out);
+    // Scans and validates without converting, leaving the tokens in `tokens`.
+    bool validate(const char* in, size_t len, TokenList& tokens);
+    // The two halves of validate(), for callers that keep tokens around.
+    bool scan(const char* in, size_t len, TokenList& tokens);
+    bool validate(const TokenList& tokens);
+    // Scans and validates as convert() does, without keeping the tokens.
+    bool validate(const char* in, size_t len);
+    // Scans and parses with error recovery, adding every problem found to
+    // `diagnostics` instead of stopping at the first one. Always uses the
+    // LL(1) table, which the recovery needs. True when nothing was found.
+    bool diagnose(const char* in, size_t len, Diagnostics& diagnostics);
+    const std::string& error() const;
+
+private:
+    bool convert_document(const char* in, size_t len, Sink& out);
+    std::unique_ptr<ContextState> state;
+};
+
+// One-shot conversion with a default Context built from tokens.txt and grammar.txt.
+bool convert(const char* in, size_t len, Sink& out);
+
+}
+
+extern "C" {
+#endif
+
+typedef struct jtx_context jtx_context;
+typedef void (*jtx_write_fn)(void* user, const char* data, size_t len);
+
+/* Returns NULL when the token or grammar file cannot be loaded. NULL paths pick the defaults. */
+jtx_context* jtx_context_new(const char* tokens_file, const char* grammar_file);
+void jtx_context_free(jtx_context* ctx);
+/* Returns 0 on success, -1 when the input is rejected or the conversion fails. */
+int jtx_convert(jtx_context* ctx, const char* in, size_t len, jtx_write_fn write, void* user);
+/* Why the last jtx_convert() on ctx failed; with a NULL ctx, why the last
+   jtx_context_new() on this thread returned NULL. */
+const char* jtx_last_error(const jtx_context* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
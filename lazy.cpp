@@ -0,0 +1,123 @@
+#include "lazy.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <istream>
+#include <string>
+
+#include "memory.h"
+#include "projection.h"
+using namespace std;
+
+namespace jsontoxml {
+
+static const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+LazyValue::LazyValue(const char* begin, const char* end) : first(skipSpace(begin, end)), limit(end) {}
+
+const char* LazyValue::extent() const {
+    if (!last) last = first < limit ? skipRawValue(first, limit) : first;
+    return last;
+}
+
+LazyValue openDocument(const char* in, size_t len) {
+    return LazyValue(in, in + len);
+}
+
+LazyValue::Type LazyValue::type() const {
+    const char* last = extent();
+    if (first == last) return INVALID;
+    switch (*first) {
+    case '{': return last[-1] == '}' ? OBJECT : INVALID;
+    case '[': return last[-1] == ']' ? ARRAY : INVALID;
+    case '"': return last - first >= 2 && last[-1] == '"' ? STRING : INVALID;
+    case 't': return raw() == "true" ? BOOLEAN : INVALID;
+    case 'f': return raw() == "false" ? BOOLEAN : INVALID;
+    case 'n': return raw() == "null" ? NULL_VALUE : INVALID;
+    default:
+        return isdigit((unsigned char)*first) || *first == '-' || *first == '+' ? NUMBER : INVALID;
+    }
+}
+
+string_view LazyValue::as_string() const {
+    if (type() != STRING) return string_view();
+    return string_view(first + 1, extent() - first - 2);
+}
+
+double LazyValue::as_number() const {
+    if (type() != NUMBER) return 0;
+    return strtod(string(raw()).c_str(), nullptr);
+}
+
+bool LazyValue::as_bool() const {
+    return raw() == "true";
+}
+
+// The iterator stops at the container's closing bracket, so its end need not be known.
+LazyValue::Iterator LazyValue::begin() const {
+    if (!opens('{') && !opens('[')) return Iterator();
+    return Iterator(first + 1, limit, *first == '{');
+}
+
+LazyValue LazyValue::operator[](string_view key) const {
+    if (!opens('{')) return LazyValue();
+    for (const Member& m : *this) {
+        if (m.key == key) return m.value();
+    }
+    return LazyValue();
+}
+
+LazyValue LazyValue::operator[](size_t index) const {
+    if (!opens('[')) return LazyValue();
+    for (const Member& m : *this) {
+        if (index-- == 0) return m.value();
+    }
+    return LazyValue();
+}
+
+void LazyValue::to_xml(XmlOutput& xml, string_view tag, int level) const {
+    if (type() == INVALID) return;
+    InputBuffer input(first, extent() - first);
+    istream ss(&input);
+    parseValue(ss, xml, level, tag);
+}
+
+LazyValue::Iterator::Iterator(const char* p, const char* end, bool object)
+    : next(p), end(end), object(object) {
+    read();
+}
+
+LazyValue::Iterator& LazyValue::Iterator::operator++() {
+    read();
+    return *this;
+}
+
+// Reads the member starting at `next` and moves `next` past its comma.
+void LazyValue::Iterator::read() {
+    const char* p = skipSpace(next, end);
+    at = nullptr;
+    if (p >= end || *p == '}' || *p == ']') return;
+    const char* start = p;
+    member.key = string_view();
+    if (object) {
+        if (*p != '"') return;
+        const char* close = findStringEnd(p + 1, end);
+        if (close == end) return;
+        member.key = string_view(p + 1, close - p - 1);
+        p = skipSpace(close + 1, end);
+        if (p == end || *p != ':') return;
+        p = skipSpace(p + 1, end);
+    }
+    member.value_begin = p;
+    member.value_end = skipRawValue(p, end);
+    if (member.value_end == p) return;
+    p = skipSpace(member.value_end, end);
+    if (p < end && *p == ',') p++;
+    next = p;
+    at = start;
+}
+
+}
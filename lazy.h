@@ -0,0 +1,86 @@
+#ifndef JSONTOXML_LAZY_H
+#define JSONTOXML_LAZY_H
+
+#include <cstddef>
+#include <string_view>
+
+#include "converter.h"
+
+namespace jsontoxml {
+
+// A view of one JSON value inside the caller's buffer. Nothing is parsed up
+// front: iterating a container finds each member's extent by skipping over
+// it, and scalars are only decoded when asked for. A value's own end is
+// found the first time type(), raw() or to_xml() needs it, so opening or
+// iterating a large container does not walk it first; that first call
+// updates the value, so a LazyValue shared between threads needs it made
+// beforehand. The buffer must outlive every LazyValue taken from it. Input
+// is not validated here; run it through a Context first when it is
+// untrusted. Malformed parts read as INVALID.
+class LazyValue {
+public:
+    enum Type { INVALID, OBJECT, ARRAY, STRING, NUMBER, BOOLEAN, NULL_VALUE };
+
+    struct Member {
+        std::string_view key; // empty for array elements
+        LazyValue value() const { return LazyValue(value_begin, value_end, value_end); }
+        const char* value_begin;
+        const char* value_end;
+    };
+
+    // Walks the members of an object or the elements of an array.
+    class Iterator {
+    public:
+        Iterator() = default;
+        Iterator(const char* p, const char* end, bool object);
+        const Member& operator*() const { return member; }
+        const Member* operator->() const { return &member; }
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const { return at == other.at; }
+        bool operator!=(const Iterator& other) const { return at != other.at; }
+
+    private:
+        void read();
+        const char* at = nullptr; // start of the current member, nullptr at the end
+        const char* next = nullptr;
+        const char* end = nullptr;
+        bool object = false;
+        Member member{};
+    };
+
+    LazyValue() = default;
+    LazyValue(const char* begin, const char* end);
+
+    Type type() const;
+    std::string_view raw() const { return std::string_view(first, extent() - first); }
+    // Between the quotes, escapes left as they are.
+    std::string_view as_string() const;
+    double as_number() const;
+    bool as_bool() const;
+
+    Iterator begin() const;
+    Iterator end() const { return Iterator(); }
+    // Linear search of an object's members / an array's elements; INVALID when absent.
+    LazyValue operator[](std::string_view key) const;
+    LazyValue operator[](size_t index) const;
+
+    // Converts just this value, as the converter would for an element named `tag`.
+    void to_xml(XmlOutput& xml, std::string_view tag = "root", int level = 0) const;
+
+private:
+    // `last` already known, as it is for an iterated member
+    LazyValue(const char* first, const char* limit, const char* last) : first(first), limit(limit), last(last) {}
+    const char* extent() const;
+    bool opens(char c) const { return first < limit && *first == c; }
+
+    const char* first = nullptr;        // first character of the value
+    const char* limit = nullptr;        // end of the buffer it was taken from
+    mutable const char* last = nullptr; // one past its last character, once found
+};
+
+// Opens the document in `in` without reading past its first character.
+LazyValue openDocument(const char* in, size_t len);
+
+}
+
+#endif
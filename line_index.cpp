@@ -0,0 +1,55 @@
+#include "line_index.h"
+
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+size_t countNewlines(const char* data, size_t len) {
+    size_t count = 0, i = 0;
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+    }
+#endif
+    for (; i < len; i++) count += data[i] == '\n';
+    return count;
+}
+
+// Offset just past the last newline in [begin, end), or `fallback` if there is none.
+static size_t lineStartIn(const char* data, size_t begin, size_t end, size_t fallback) {
+    for (size_t p = end; p > begin; p--) {
+        if (data[p - 1] == '\n') return p;
+    }
+    return fallback;
+}
+
+void LineIndex::build(size_t upto) {
+    // blocks are counted in order, only as far as a lookup has needed
+    for (size_t b = newlines.size(); b <= upto; b++) {
+        size_t count = 0, start = 0;
+        if (b > 0) {
+            size_t begin = (b - 1) * BLOCK, end = min(len, begin + BLOCK);
+            size_t n = countNewlines(data + begin, end - begin);
+            count = newlines[b - 1] + n;
+            start = n ? lineStartIn(data, begin, end, 0) : line_start[b - 1];
+        }
+        newlines.push_back(count);
+        line_start.push_back(start);
+    }
+}
+
+void LineIndex::locate(size_t offset, int& line, int& column) {
+    offset = min(offset, len);
+    size_t b = offset / BLOCK, begin = b * BLOCK;
+    if (b >= newlines.size()) build(b);
+    line = int(newlines[b] + countNewlines(data + begin, offset - begin)) + 1;
+    column = int(offset - lineStartIn(data, begin, offset, line_start[b])) + 1;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef JSONTOXML_LINE_INDEX_H
+#define JSONTOXML_LINE_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+namespace jsontoxml {
+
+// Turns byte offsets into line and column numbers for error reporting, so
+// the scanner never has to track lines itself. Nothing is done until a
+// locate() needs it: the newlines of each block up to the offset asked for
+// are counted once (16 bytes at a time with SSE2), and after that a lookup
+// only looks inside one block.
+class LineIndex {
+public:
+    LineIndex(const char* data, size_t len) : data(data), len(len) {}
+
+    // 1-based line and column (in bytes) of the byte at `offset`.
+    void locate(size_t offset, int& line, int& column);
+
+private:
+    static const size_t BLOCK = 4096;
+    void build(size_t upto);
+
+    const char* data;
+    size_t len;
+    // newlines before each block, and where the line running into it starts
+    std::vector<size_t> newlines;
+    std::vector<size_t> line_start;
+};
+
+size_t countNewlines(const char* data, size_t len);
+
+}
+
+#endif
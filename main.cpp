@@ -1,810 +1,440 @@
 #include <iostream>
 #include <fstream>
-#include <regex>
 #include <vector>
-#include <map>
-#include <set>
 #include <string>
 #include <sstream>
-#include <algorithm>
-#include <stack>
-#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <filesystem>
+#include <optional>
+#include <fcntl.h>
+#include <unistd.h>
+#include "batch.h"
+#include "codegen.h"
+#include "compress.h"
+#include "follow.h"
+#include "iovec_sink.h"
+#include "jsontoxml.h"
+#include "memory.h"
+#include "parallel_write.h"
+#include "projection.h"
+#include "shape.h"
+#include "shard.h"
+#include "trace.h"
+#include "xml_index.h"
 using namespace std;
 
-bool valid = true;
-
-// Scanner
-struct TokenRule {
-    string name;
-    regex pattern;
-};
-vector<TokenRule> loadTokenRules(const string& filename) {
-    vector<TokenRule> rules;
-    ifstream file(filename);
-    string name, pattern;
-
-    while (file >> name) {
-        file >> ws;
-        getline(file, pattern);
-        rules.push_back({name, regex(pattern)});
+// heap counting for --stats
+void* operator new(size_t size) {
+    if (jsontoxml::countAllocations.load(memory_order_relaxed)) {
+        jsontoxml::allocationCount.fetch_add(1, memory_order_relaxed);
+        jsontoxml::allocatedBytes.fetch_add(size, memory_order_relaxed);
     }
-
-    return rules;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Moves a finished xml.txt.tmp over xml.txt, printing why when it cannot.
+static bool replaceOutput() {
+    if (rename("xml.txt.tmp", "xml.txt") == 0) return true;
+    cerr << "Error: Cannot rename 'xml.txt.tmp' to 'xml.txt': " << strerror(errno) << endl;
+    remove("xml.txt.tmp");
+    return false;
 }
 
-void scanInput(const string& inputFilename, const vector<TokenRule>& rules, const string& outputFilename) {
-    ifstream input(inputFilename);
-    ofstream output(outputFilename);
-    
-    if (!input) {
-        cerr << "Error: Cannot open input file " << inputFilename << endl;
-        valid = false;
-        return;
-    }
-    
-    if (!output) {
-        cerr << "Error: Cannot create output file " << outputFilename << endl;
-        valid = false;
-        return;
-    }
-    
-    string line;
-    int lineNum = 1;
-    bool errorFound = false;
-
-    while (getline(input, line)) {
-        size_t i = 0;
-        while (i < line.size()) {
-            bool matched = false;
-            for (const auto& rule : rules) {
-                smatch match;
-                string substr = line.substr(i);
-                if (regex_search(substr, match, rule.pattern) && match.position() == 0) {
-                    if (rule.name != "WHITESPACE") {
-                        output << rule.name << " " << match.str() << endl;
-                    }
-                    i += match.length();
-                    matched = true;
-                    break;
-                }
+int main(int argc, char* argv[]) {
+    string inputFile = "json.text";
+    jsontoxml::Options options;
+    jsontoxml::Stats stats;
+    string statsFormat;
+    string traceFile = "trace.bin";
+    string cacheDir;
+    jsontoxml::PathSelector select;
+    string indexFile;
+    size_t indexDepth = 2;
+    string compressFormat;
+    size_t maxErrors = 100;
+    bool follow = false;
+    jsontoxml::FollowOptions followOptions;
+    string shapeName;
+    bool useWritev = false;
+    bool parallelWrite = false;
+    string batchDir;
+    vector<string> batchInputs;
+    jsontoxml::BatchOptions batchOptions;
+    jsontoxml::ShardOptions shardOptions;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--dump-artifacts") {
+            options.dump_artifacts = true;
+        } else if (arg == "--pipeline") {
+            options.pipelined = true;
+        } else if (arg == "--stream") {
+            options.streaming = true;
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            jsontoxml::traceLevel = atoi(arg.c_str() + 8);
+            if (jsontoxml::traceLevel > JSONTOXML_TRACE_LEVEL) {
+                cerr << "Warning: tracing above level " << JSONTOXML_TRACE_LEVEL << " is compiled out" << endl;
             }
-            if (!matched) {
-                output << "ERROR: Unknown token at line " << lineNum << " near: " << line[i] << endl;
-                errorFound = true;
-                break;
+        } else if (arg == "--trace-file" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (arg == "--decode-trace" && i + 1 < argc) {
+            return jsontoxml::decodeTrace(argv[++i], cout) ? 0 : 1;
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (arg == "--select" && i + 1 < argc) {
+            string error;
+            if (!select.add(argv[++i], error)) {
+                cerr << error << endl;
+                return 1;
             }
-        }
-        if (errorFound) break;
-        lineNum++;
-    }
-
-    if (!errorFound) {
-        cout << "ACCEPTED" << endl;
-    } else {
-        valid = false;
-    }
-    
-    input.close();
-    output.close();
-}
-
-// create first and follow files
-map<string, vector<vector<string>>> grammarr;
-map<string, set<string>> firstSets, followSets;
-string startSymbol;
-bool isNonTerminal(const string &symbol) {
-    return isupper(symbol[0]);
-}
-void readGrammar(const string &filename) {
-    ifstream file(filename);
-    if (!file) {
-        cerr << "Error: Cannot open " << filename << endl;
-        return; // or exit(1)
-    }
-    string line;
-    int lineCount = 0;
-
-    while (getline(file, line)) {
-        lineCount++;
-        if (lineCount <= 3 || line.empty()) continue;
-        size_t tabPos = line.find('\t');
-        if (tabPos == string::npos) continue;
-
-        string lhs = line.substr(0, tabPos);
-        lhs.erase(remove(lhs.begin(), lhs.end(), ' '), lhs.end());
-
-        if (startSymbol.empty()) startSymbol = lhs;
-
-        string rhs = line.substr(tabPos + 1);
-        istringstream prodStream(rhs);
-        string prod;
-        while (getline(prodStream, prod, '|')) {
-            istringstream symbolStream(prod);
-            vector<string> production;
-            string symbol;
-            while (symbolStream >> symbol) {
-                production.push_back(symbol);
+            options.select = &select;
+        } else if (arg == "--index" && i + 1 < argc) {
+            indexFile = argv[++i];
+        } else if (arg.rfind("--index-depth=", 0) == 0) {
+            indexDepth = strtoul(arg.c_str() + 14, nullptr, 10);
+        } else if (arg == "--index-lookup" && i + 3 < argc) {
+            // --index-lookup INDEX XML PATH: print one element of a converted file
+            string error;
+            uint64_t offset, length;
+            if (!jsontoxml::lookupIndex(argv[i + 1], argv[i + 3], offset, length, error)) {
+                cerr << error << endl;
+                return 1;
+            }
+            ifstream xml(argv[i + 2], ios::binary);
+            string element(length, '\0');
+            if (!xml.seekg(offset) || !xml.read(&element[0], length)) {
+                cerr << "Error: Cannot read " << argv[i + 2] << endl;
+                return 1;
+            }
+            cout << element;
+            return 0;
+        } else if (arg == "--compress=gzip" || arg == "--compress=zstd") {
+            compressFormat = arg.substr(11);
+        } else if (arg == "--gen-parser" && i + 1 < argc) {
+            string error;
+            if (!jsontoxml::generateParserFile(options.grammar_file, argv[++i], error)) {
+                cerr << error << endl;
+                return 1;
             }
-            grammarr[lhs].push_back(production);
+            return 0;
+        } else if ((arg == "--gen-converter" || arg == "--gen-converter-schema") && i + 2 < argc) {
+            // --gen-converter SAMPLES OUTPUT: a converter specialized for the samples' shape
+            string error;
+            if (!jsontoxml::generateConverterFile(argv[i + 1], arg == "--gen-converter-schema", argv[i + 2], error)) {
+                cerr << error << endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--shape-plugin" && i + 1 < argc) {
+            string error;
+            if (!jsontoxml::loadShapePlugin(argv[++i], error)) {
+                cerr << error << endl;
+                return 1;
+            }
+        } else if (arg == "--shape" && i + 1 < argc) {
+            shapeName = argv[++i];
+        } else if (arg == "--writev") {
+            useWritev = true;
+        } else if (arg == "--parallel-write") {
+            parallelWrite = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            // --batch OUTDIR FILE...: convert each file to OUTDIR/<name>.xml
+            batchDir = argv[++i];
+        } else if (arg == "--batch-list" && i + 1 < argc) {
+            // the batch's inputs, one path per line
+            ifstream list(argv[++i]);
+            if (!list) {
+                cerr << "Error: Cannot read " << argv[i] << endl;
+                return 1;
+            }
+            for (string line; getline(list, line);) {
+                if (!line.empty()) batchInputs.push_back(line);
+            }
+        } else if (arg == "--io=uring" || arg == "--io=threads") {
+            batchOptions.backend = arg == "--io=uring" ? jsontoxml::IoBackend::URING : jsontoxml::IoBackend::THREADS;
+        } else if (arg.rfind("--queue-depth=", 0) == 0) {
+            batchOptions.queue_depth = strtoul(arg.c_str() + 14, nullptr, 10);
+        } else if (arg.rfind("--workers=", 0) == 0) {
+            batchOptions.workers = strtoul(arg.c_str() + 10, nullptr, 10);
+        } else if (arg.rfind("--shards=", 0) == 0) {
+            shardOptions.shards = strtoul(arg.c_str() + 9, nullptr, 10);
+        } else if (arg.rfind("--shard-records=", 0) == 0) {
+            shardOptions.records = strtoul(arg.c_str() + 16, nullptr, 10);
+        } else if (arg.rfind("--shard-bytes=", 0) == 0) {
+            shardOptions.bytes = strtoull(arg.c_str() + 14, nullptr, 10);
+        } else if (arg == "--shard-prefix" && i + 1 < argc) {
+            shardOptions.prefix = argv[++i];
+        } else if (arg == "--follow") {
+            follow = true;
+        } else if (arg == "--follow-state" && i + 1 < argc) {
+            followOptions.state_file = argv[++i];
+        } else if (arg.rfind("--poll-ms=", 0) == 0) {
+            followOptions.poll_ms = atoi(arg.c_str() + 10);
+        } else if (arg.rfind("--max-errors=", 0) == 0) {
+            maxErrors = strtoul(arg.c_str() + 13, nullptr, 10);
+        } else if (arg == "--rd-parser") {
+            options.generated_parser = true;
+        } else if (arg == "--stats" || arg == "--stats=json") {
+            statsFormat = arg == "--stats" ? "text" : "json";
+            options.stats = &stats;
+            jsontoxml::countAllocations = true;
+        } else {
+            inputFile = arg;
+            batchInputs.push_back(arg);
         }
     }
-}
-
-set<string> first(const string &symbol);
-set<string> first(const vector<string> &symbols) {
-    set<string> result;
-    for (const string &symbol : symbols) {
-        set<string> temp = first(symbol);
-        result.insert(temp.begin(), temp.end());
-        if (temp.find("e") == temp.end()) break;
-        else if (symbol == symbols.back()) result.insert("e");
-    }
-    return result;
-}
-set<string> first(const string &symbol) {
-    if (!isNonTerminal(symbol)) return {symbol};
-
-    if (!firstSets[symbol].empty()) return firstSets[symbol];
-
-    for (const auto &prod : grammarr[symbol]) {
-        set<string> temp = first(prod);
-        firstSets[symbol].insert(temp.begin(), temp.end());
-    }
 
-    return firstSets[symbol];
-}
-void computeFirst() {
-    for (const auto &entry : grammarr) {
-        const string &nonTerminal = entry.first;
-        first(nonTerminal);
-    }
-}
-void computeFollow() {
-    followSets[startSymbol].insert("$");
-
-    bool updated = true;
-    while (updated) {
-        updated = false;
-
-        for (const auto &rule : grammarr) {
-            const string &head = rule.first;
-
-            for (const auto &prod : rule.second) {
-                for (size_t i = 0; i < prod.size(); ++i) {
-                    const string &B = prod[i];
-                    if (!isNonTerminal(B)) continue;
-
-                    if (i + 1 < prod.size()) {
-                        vector<string> beta(prod.begin() + i + 1, prod.end());
-                        set<string> firstBeta = first(beta);
-
-                        size_t before = followSets[B].size();
-                        for (const string &sym : firstBeta) {
-                            if (sym != "e") followSets[B].insert(sym);
-                        }
-
-                        if (firstBeta.count("e")) {
-                            followSets[B].insert(followSets[head].begin(), followSets[head].end());
-                        }
-
-                        if (followSets[B].size() > before) updated = true;
-                    } else {
-                        size_t before = followSets[B].size();
-                        followSets[B].insert(followSets[head].begin(), followSets[head].end());
-                        if (followSets[B].size() > before) updated = true;
-                    }
-                }
-            }
+    vector<string> requiredFiles = {"tokens.txt", "grammar.txt"};
+    for (const string& file : requiredFiles) {
+        ifstream check(file);
+        if (!check) {
+            cerr << "Error: Required file '" << file << "' not found!" << endl;
+            return 1;
         }
+        check.close();
     }
-}
-void writeSetToFile(const string &filename, const map<string, set<string>> &sets, const string &label) {
-    ofstream out(filename);
-    for (const auto &entry : sets) {
-        out << entry.first << " ";
-        for (const auto &sym : entry.second) {
-            out << sym << " ";
+
+    if (!shapeName.empty()) {
+        options.shape = jsontoxml::findShapeConverter(shapeName);
+        if (!options.shape) {
+            cerr << "Error: No converter named '" << shapeName << "'; load it with --shape-plugin" << endl;
+            return 1;
         }
-        out << endl;
     }
-}
 
-// parsing table
-struct Grammar {
-    vector<string> terminals;
-    vector<string> nonterminals;
-    string startsymbol;
-    map<string, vector<string>> production_rules;
-};
-struct Predictive_table {
-    string nonterminal;
-    string first;
-    string rule;
-};
-class ParsingTable {
-private:
-    map<string, vector<string>> first;
-    map<string, vector<string>> follow;
-    Grammar grammar;
-    vector<Predictive_table> predictive_table;
+    // a rejected input is checked again to report all of its errors, not just the first
+    jsontoxml::Diagnostics diagnostics(maxErrors);
+    if (maxErrors > 0 && !follow) options.diagnostics = &diagnostics;
 
-public:
-    ParsingTable(string fst, string flo, string grm) {
-        cout << "Creating object..." << endl;
-        read_first(fst);
-        for (const auto& [nonterminal, symbols] : first) {
-            cout << "First of " << nonterminal << ": ";
-            for (const string& sym : symbols) cout << sym << " ";
-            cout << endl;
+    if (!batchDir.empty()) {
+        if (follow || useWritev || !compressFormat.empty() || !indexFile.empty()) {
+            cerr << "Error: --batch cannot be combined with --follow, --writev, --compress or --index" << endl;
+            return 1;
         }
-
-        read_follow(flo);
-        for (const auto& [nonterminal, symbols] : follow) {
-            cout << "Follow of " << nonterminal << ": ";
-            for (const string& sym : symbols) cout << sym << " ";
-            cout << endl;
+        batchOptions.output_dir = batchDir;
+        jsontoxml::BatchResult result;
+        string error;
+        if (!jsontoxml::convertBatch(options, batchInputs, batchOptions, result, error)) {
+            cerr << error << endl;
+            return 1;
         }
-
-        read_grammar(grm);
-        for (const auto& [nonterminal, symbols] : grammar.production_rules) {
-            cout << "rule of " << nonterminal << ": ";
-            for (const string& sym : symbols) cout << sym << " ";
-            cout << endl;
+        cout << "Converted " << result.converted << " of " << batchInputs.size() << " files (" << result.rejected
+             << " rejected, " << result.failed << " failed) with " << result.backend << " I/O" << endl;
+        if (!statsFormat.empty()) {
+            cerr << "batch: " << result.bytes_in << " bytes in, " << result.bytes_out << " bytes out" << endl;
         }
+        return result.converted == batchInputs.size() ? 0 : 1;
     }
 
-    void read_first(string fst) {
-        ifstream infirst(fst);
-        if (!infirst) {
-            cerr << "Error opening first.txt!" << endl;
-            return;
+    if (follow) {
+        // convert each line appended to the input, appending to xml.txt until interrupted
+        if (!compressFormat.empty() || !indexFile.empty()) {
+            cerr << "Error: --follow cannot be combined with --compress or --index" << endl;
+            return 1;
         }
-
-        string line;
-        while (getline(infirst, line)) {
-            stringstream s(line);
-            string nonterminal;
-            s >> nonterminal;
-            string symbol;
-            vector<string> symbols;
-            while (s>>symbol) {
-                symbols.push_back(remove_spaces(symbol));
-            }
-            first[remove_spaces(nonterminal)] = symbols;
+        jsontoxml::Context context(options);
+        string error;
+        if (!context.ok() || !jsontoxml::followFile(context, inputFile, "xml.txt", followOptions, error)) {
+            cerr << (context.ok() ? error : context.error()) << endl;
+            return 1;
         }
-        infirst.close();
+        if (statsFormat == "text") stats.print(cerr);
+        else if (statsFormat == "json") stats.print_json(cerr);
+        return 0;
     }
 
-    void read_follow(string flo) {
-        ifstream infollow(flo);
-        if (!infollow) {
-            cerr << "Error opening follow.txt!" << endl;
-            return;
-        }
-
-        string line;
-        while (getline(infollow, line)) {
-            stringstream s(line);
-            string nonterminal;
-            s >> nonterminal;
-            string symbol;
-            vector<string> symbols;
-            while (s>>symbol) {
-                symbols.push_back(remove_spaces(symbol));
-            }
-            follow[remove_spaces(nonterminal)] = symbols;
-        }
-        infollow.close();
+    // the records of the top-level or --select'ed array go to shard files instead of xml.txt
+    int shardModes = !!shardOptions.shards + !!shardOptions.records + !!shardOptions.bytes;
+    bool sharding = shardModes > 0;
+    if (shardModes > 1) {
+        cerr << "Error: Use only one of --shards, --shard-records and --shard-bytes" << endl;
+        return 1;
     }
-
-    void read_grammar(string grm) {
-        ifstream ingrammar(grm);
-        if (!ingrammar) {
-            cerr << "Error opening grammar.txt!" << endl;
-            return;
-        }
-
-        string line;
-        if (getline(ingrammar, line)) {
-            stringstream s(line);
-            string terminal;
-            while (s>>terminal) {
-                grammar.terminals.push_back(remove_spaces(terminal));
-            }
-        }
-
-        if (getline(ingrammar, line)) {
-            stringstream s(line);
-            string nonterminal;
-            while (s>>nonterminal) {
-                grammar.nonterminals.push_back(remove_spaces(nonterminal));
-            }
-        }
-
-        if (getline(ingrammar, line)) {
-            grammar.startsymbol = remove_spaces(line);
-        }
-
-        while (getline(ingrammar, line)) {
-            stringstream s(line);
-            string nonterminal;
-            s >> nonterminal;
-            string rule;
-            vector<string> rules;
-            while (getline(s, rule, '|')) {
-                rules.push_back(trim(rule));
-            }
-            grammar.production_rules[remove_spaces(nonterminal)] = rules;
-        }
-        ingrammar.close();
+    if (sharding && (useWritev || !compressFormat.empty() || !indexFile.empty())) {
+        cerr << "Error: Sharded output cannot be combined with --writev, --compress or --index" << endl;
+        return 1;
     }
+    if (sharding && options.select) {
+        shardOptions.select = options.select;
+        options.select = nullptr;
+    }
+    shardOptions.writers = batchOptions.workers;
 
-    void build_parsing_table(string output) {
-        ofstream predfile(output);
-        if (!predfile) {
-            cerr << "Error opening output file!" << endl;
-            return;
-        }
-        cout << "Starting to build parsing table..." << endl;
-
-        for (const auto& [nonterminal, rules] : grammar.production_rules) {
-            for (const string& rule : rules) {
-                vector<string> symbols = split_rule(rule);
-                if (symbols.empty()) {
-                    continue;
-                }
-
-                string symbol = symbols[0];
-                if (find(grammar.terminals.begin(), grammar.terminals.end(), symbol) != grammar.terminals.end()) {
-                    predictive_table.push_back({ nonterminal, symbol, rule });
-                    cout << "Building entry for: " << nonterminal << " -> " << rule << endl;
-                }
-                else if (find(grammar.nonterminals.begin(), grammar.nonterminals.end(), symbol) != grammar.nonterminals.end()) {
-                    for (const string& fst : first[symbol]) {
-                        if (fst != "e") {
-                            predictive_table.push_back({ nonterminal, fst, rule });
-                            cout << "Building entry for: " << nonterminal << " -> " << rule << endl;
-                        }
-                        else {
-                            for (const string& flo : follow[symbol]) {
-                                predictive_table.push_back({ nonterminal, flo, rule });
-                                cout << "Building entry for: " << nonterminal << " -> " << rule << endl;
-                            }
-                        }
-                    }
-                }
-                else if (symbol == "e") {
-                    for (const string& flo : follow[nonterminal]) {
-                        predictive_table.push_back({ nonterminal, flo, rule });
-                        cout << "Building entry for: " << nonterminal << " -> " << rule << endl;
-                    }
-                }
-            }
-        }
-        predfile << grammar.startsymbol << endl;
-        for (const auto& entry : predictive_table) {
-            predfile << entry.nonterminal << " " << entry.first << "\t" << entry.rule << endl;
-            cout << "Writing: " << entry.nonterminal << "," << entry.first << "\t" << entry.rule << endl;
-        }
-
-        cout << "Writing to file completed." << endl;
-        predfile.close();
+    if (parallelWrite && (sharding || useWritev || !compressFormat.empty() || !indexFile.empty() || options.select)) {
+        cerr << "Error: --parallel-write cannot be combined with sharding, --writev, --compress, --index or --select"
+             << endl;
+        return 1;
     }
 
-    vector<string> split_rule(const string& rule) {
-        stringstream ss(rule);
-        string sym;
-        vector<string> result;
-        while (ss >> sym) result.push_back(remove_spaces(sym));
-        return result;
+    if (useWritev && !compressFormat.empty()) {
+        cerr << "Error: --writev cannot be combined with --compress" << endl;
+        return 1;
     }
 
-    string remove_spaces(const string& str) {
-        string result = "";
-        for (char c : str) {
-            if (c != ' ') result += c;
+    // mapped rather than read, so --writev can send string values straight from it
+    jsontoxml::MappedFile json;
+    {
+        jsontoxml::StageTimer timer(options.stats, "read_input");
+        string error;
+        if (!json.open(inputFile, error)) {
+            cerr << error << endl;
+            return 1;
         }
-        return result;
+        timer.bytes_out = json.size();
     }
 
-    string trim(const string& str) {
-        size_t first = str.find_first_not_of(" \t");
-        if (first == string::npos)
-            return "";
-
-        size_t last = str.find_last_not_of(" \t");
-        return str.substr(first, last - first + 1);
+    // a one-shot run only benefits from the cache through its spill directory
+    optional<jsontoxml::ResultCache> cache;
+    if (!cacheDir.empty()) {
+        error_code ec;
+        filesystem::create_directories(cacheDir, ec);
+        jsontoxml::CacheLimits limits;
+        limits.spill_dir = cacheDir;
+        cache.emplace(limits);
+        options.cache = &*cache;
     }
-};
-
-// parser LL-1
-class LL1_parser{
-    private:
-    Grammar grammar;
-    stack<string> tokens, temp_stack;
-    string startsymbol="";
-    vector<Predictive_table> predictive_table;
 
-    public:
-    LL1_parser(string inp, string inpre, string grm){
-        read_input(inp);
-        read_predictive_table(inpre);
-        read_grammar(grm);
-    }
-    void read_input(string inp){
-        ifstream in(inp);
-        if (!in) {
-            cerr << "error" << endl;
-            return;
-        }
-        string line;
-        vector<string> tokens1;
-        while(getline(in,line)){
-            stringstream s(line);
-            string token;
-            s>>token;
-            tokens1.push_back(remove_spaces(token));
-        }
-        tokens.push("$");
-        for (int i = tokens1.size() - 1; i >= 0; --i){
-            cout << "Pushed token: " << remove_spaces(tokens1[i]) << endl;
-            tokens.push(remove_spaces(tokens1[i]));
-        }
-        cout << "tokens stack" << endl;
-        print_stack(tokens);
-        in.close();
+    optional<jsontoxml::XmlIndex> index;
+    if (!indexFile.empty()) {
+        index.emplace(indexDepth);
+        options.index = &*index;
     }
-    void read_predictive_table(string inpre){
-        ifstream inpredictivetable(inpre);
-        if (!inpredictivetable) {
-            cerr << "error" << endl;
-            return;
-        }
-        string line;
-        set<pair<string, string>> rules_check;
-        if(getline(inpredictivetable,line)){
-            startsymbol = remove_spaces(line);
-            cout << "Start symbol: " << startsymbol << endl;
-        }
-        while(getline(inpredictivetable,line)){
-            stringstream ss(line);
-            string nonterminal,first,rule;
-            ss>>nonterminal>>first;
-            getline(ss,rule);
-            nonterminal = remove_spaces(nonterminal);
-            first = remove_spaces(first);
-            if (rules_check.count({nonterminal, first})) {
-                cerr << "Error: Conflict in parse table at (" << nonterminal << "," << first << ")" << endl;
-                exit(1);
-            }
-            rules_check.insert({nonterminal, first});
-            predictive_table.push_back({nonterminal, first, rule});
-        }
-        inpredictivetable.close();
-    }
-    void read_grammar(string grm) {
-        ifstream ingrammar(grm);
-        if (!ingrammar) {
-            cerr << "Error opening grammar.txt!" << endl;
-            return;
-        }
 
-        string line;
-        if (getline(ingrammar, line)) {
-            stringstream s(line);
-            string terminal;
-            while (s>>terminal) {
-                grammar.terminals.push_back(remove_spaces(terminal));
-            }
-        }
-
-        if (getline(ingrammar, line)) {
-            stringstream s(line);
-            string nonterminal;
-            while (s>>nonterminal) {
-                grammar.nonterminals.push_back(remove_spaces(nonterminal));
-            }
-        }
+    jsontoxml::Context context(options);
+    if (!context.ok()) {
+        cerr << context.error() << endl;
+        return 1;
+    }
 
-        if (getline(ingrammar, line)) {
-            grammar.startsymbol = remove_spaces(line);
+    jsontoxml::StringSink sink;
+    bool valid;
+    bool outputFailed = false; // accepted, but the output could not be written; already reported
+    if (!compressFormat.empty()) {
+        // compress straight into xml.txt.gz / xml.txt.zst instead of keeping the XML around
+        jsontoxml::Compression format = compressFormat == "gzip" ? jsontoxml::Compression::GZIP
+                                                                 : jsontoxml::Compression::ZSTD;
+        if (!jsontoxml::compressionAvailable(format)) {
+            cerr << "Error: " << compressFormat << " support is not compiled in" << endl;
+            return 1;
         }
-
-        while (getline(ingrammar, line)) {
-            stringstream s(line);
-            string nonterminal;
-            s >> nonterminal;
-            string rule;
-            vector<string> rules;
-            while (getline(s, rule, '|')) {
-                rules.push_back(trim(rule));
+        string outputFile = format == jsontoxml::Compression::GZIP ? "xml.txt.gz" : "xml.txt.zst";
+        ofstream output(outputFile, ios::binary);
+        jsontoxml::StreamSink file(output);
+        jsontoxml::CompressedSink compressed(file, format);
+        valid = context.convert(json.data(), json.size(), compressed);
+        {
+            jsontoxml::StageTimer timer(options.stats, "write_output");
+            bool written = compressed.finish();
+            if (!written) cerr << "Error: Compression failed" << endl;
+            output.close();
+            if (written && valid && !output) {
+                cerr << "Error: Cannot write output file '" << outputFile << "'" << endl;
+                written = false;
             }
-            grammar.production_rules[remove_spaces(nonterminal)] = rules;
-        }
-        ingrammar.close();
-    }
-    void check_parser(string outp){
-        ofstream out(outp);
-        if (!out) {
-            cerr << "error" << endl;
-            return;
-        }
-        temp_stack.push("$");
-        temp_stack.push(startsymbol);
-        while(temp_stack.top()!="$"){
-            string top_r=temp_stack.top();
-            string top_i=tokens.top();
-            cout << "Top of stack: " << top_r << ", Current token: " << top_i << endl;
-
-            if(is_terminal(top_r)){
-                if(top_r==top_i){
-                    temp_stack.pop();
-                    tokens.pop();
-                } else{
-                    return;
-                }
-            } else if(is_nonterminal(top_r)){
-                string rule;
-                string nonterm = top_r;
-                rule = get_rule(nonterm,top_i);
-                if(rule!=""){
-                    temp_stack.pop();
-                    vector<string> srules=split_rule(rule);
-                    for (int i = srules.size() - 1; i >= 0; --i){
-                        temp_stack.push(remove_spaces(srules[i]));
-                    }
-                } else{
-                    return;
-                }
-                print_stack(tokens);
-                print_stack(temp_stack);
-            } else if(top_r=="e"){
-                temp_stack.pop();
-                print_stack(tokens);
-                print_stack(temp_stack);
-            } else {
-                return;
+            if (!written) {
+                outputFailed = valid;
+                valid = false;
             }
         }
-        if(tokens.top()=="$"&&temp_stack.top()=="$"){
-            out<<"accepted!!";
-            cout <<"accepted!!"<<endl;
-        } else {
-            valid = false;
-            out<<"not accepted!!";
-            cout<<"not accepted!!"<<endl;
-        }
-        out.close();
-    }
-    bool is_terminal(string term){
-        for(string t : grammar.terminals){
-            if(term == t){
-                return true;
-            }
+        if (!valid) remove(outputFile.c_str());
+    } else if (useWritev) {
+        // XML goes to stdout and xml.txt as gathered writes, replacing xml.txt once accepted
+        int file = open("xml.txt.tmp", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (file < 0) {
+            cerr << "Error: Cannot open output file 'xml.txt.tmp'" << endl;
+            return 1;
         }
-        return false;
-    }
-    bool is_nonterminal(string nterm){
-        for(string t : grammar.nonterminals){
-            if(nterm == t){
-                return true;
+        jsontoxml::IovecSink gathered({STDOUT_FILENO, file});
+        valid = context.convert(json.data(), json.size(), gathered);
+        {
+            jsontoxml::StageTimer timer(options.stats, "write_output", gathered.bytes());
+            if (valid && !gathered.flush()) {
+                cerr << gathered.error() << endl;
+                outputFailed = true;
             }
-        }
-        return false;
-    }
-    string get_rule(string nonterminal,string terminal){
-        for(Predictive_table t : predictive_table){
-            if(t.nonterminal==nonterminal&&t.first==terminal){
-                cout << "Matched Rule: " << t.rule << " for " << nonterminal << "," << terminal << endl;
-                return t.rule;
+            if (close(file) != 0 && valid && !outputFailed) {
+                cerr << "Error: Cannot write 'xml.txt.tmp': " << strerror(errno) << endl;
+                outputFailed = true;
             }
         }
-        cout << "No rule found for: " << nonterminal << "," << terminal << endl;
-        return "";
-    }
-    vector<string> split_rule(const string& rule) {
-        stringstream ss(rule);
-        string sym;
-        vector<string> result;
-        while (ss >> sym) result.push_back(sym);
-        return result;
-    }
-    string remove_spaces(const string& str) {
-        string result = "";
-        for (char c : str) {
-            if (c != ' ')
-                result += c;
+        if (valid && !outputFailed && !replaceOutput()) outputFailed = true;
+        if (outputFailed) valid = false;
+        if (!valid) remove("xml.txt.tmp");
+        if (!statsFormat.empty()) {
+            cerr << "writev: " << gathered.referenced_bytes() << " of " << gathered.bytes()
+                 << " bytes sent by reference" << endl;
+        }
+    } else if (sharding) {
+        valid = context.validate(json.data(), json.size());
+        if (!valid && options.diagnostics) context.diagnose(json.data(), json.size(), *options.diagnostics);
+        vector<jsontoxml::ShardInfo> shards;
+        string error;
+        jsontoxml::StageTimer timer(options.stats, "write_output");
+        if (valid && !jsontoxml::writeShards(json.data(), json.size(), inputFile, shardOptions, shards, error)) {
+            cerr << error << endl;
+            return 1;
         }
-        return result;
-    }
-    void print_stack(stack<string> s) {
-        vector<string> temp;
-        while (!s.empty()) {
-            temp.push_back(s.top());
-            s.pop();
+        for (const jsontoxml::ShardInfo& shard : shards) timer.bytes_out += shard.bytes;
+        if (valid) cout << "Wrote " << shards.size() << " shards listed in " << shardOptions.prefix << ".manifest.json" << endl;
+    } else if (parallelWrite) {
+        // converted on --workers threads and written to xml.txt at precomputed offsets
+        valid = context.validate(json.data(), json.size());
+        if (!valid && options.diagnostics) context.diagnose(json.data(), json.size(), *options.diagnostics);
+        uint64_t bytes = 0;
+        string error;
+        if (valid && !jsontoxml::writeParallel(json.data(), json.size(), "xml.txt.tmp", batchOptions.workers,
+                                                options.stats, bytes, error)) {
+            cerr << error << endl;
+            remove("xml.txt.tmp");
+            return 1;
         }
-        for (int i = temp.size()-1; i >= 0; --i) {
-            cout << temp[i] << " ";
+        if (valid && !replaceOutput()) {
+            valid = false;
+            outputFailed = true;
         }
-        cout << endl;
-    }
-    string trim(const string& str) {
-        size_t first = str.find_first_not_of(" \t");
-        if (first == string::npos)
-            return "";
-
-        size_t last = str.find_last_not_of(" \t");
-        return str.substr(first, last - first + 1);
+    } else {
+        valid = context.convert(json.data(), json.size(), sink);
     }
-};
-
 
+    ofstream out("output.txt");
+    out << (valid ? "accepted!!" : "not accepted!!");
+    out.close();
 
-// JSON file to XML file
-string indent(int level) {
-    return string(level * 2, ' ');
-}
-string trim(const string& s) {
-    size_t start = s.find_first_not_of(" \t\r\n");
-    size_t end = s.find_last_not_of(" \t\r\n");
-    if (start == string::npos || end == string::npos) return "";
-    return s.substr(start, end - start + 1);
-}
-string parseJSONtoXML(stringstream& ss, int level = 0, const string& currentTag = "root");
-string parseValue(stringstream& ss, int level, const string& tag);
-string parseString(stringstream& ss) {
-    string result;
-    char ch;
-    while (ss.get(ch)) {
-        if (ch == '"') break;
-        result += ch;
-    }
-    return result;
-}
-string parseObject(stringstream& ss, int level, const string& tag) {
-    string xml = indent(level) + "<" + tag + ">\n";
-    string key, value;
-    char ch;
+    if (valid && compressFormat.empty() && !useWritev && !sharding && !parallelWrite) {
+        cout << sink.str;
 
-    while (ss >> ch) {
-        if (ch == '"') {
-            key = parseString(ss);
-
-            // skip colon
-            while (ss >> ch && ch != ':');
+        jsontoxml::StageTimer timer(options.stats, "write_output", sink.str.size());
+        ofstream output("xml.txt");
+        output << sink.str;
+        output.close();
+        timer.bytes_out = sink.str.size();
 
-            xml += parseValue(ss, level + 1, key);
-        } else if (ch == '}') {
-            break;
+    } else if (outputFailed) {
+        // reported where it happened
+    } else if (!valid && diagnostics.list.empty()) {
+        cerr << context.error() << endl;
+    } else if (!valid) {
+        for (const jsontoxml::Diagnostic& diagnostic : diagnostics.list) {
+            cerr << inputFile << ": " << jsontoxml::formatDiagnostic(diagnostic) << endl;
         }
+        if (diagnostics.full()) cerr << "Stopped after " << diagnostics.limit << " errors" << endl;
     }
-
-    xml += indent(level) + "</" + tag + ">\n";
-    return xml;
-}
-string parseArray(stringstream& ss, int level, const string& tag) {
-    string xml;
-    char ch;
-
-    while (ss >> ch) {
-        if (ch == ']') break;
-        ss.putback(ch);
-
-        xml += indent(level) + "<" + tag + ">\n";
-        xml += parseValue(ss, level + 1, "item");
-        xml += indent(level) + "</" + tag + ">\n";
-
-        ss >> ch;
-        if (ch != ',' && ch != ']') ss.putback(ch);
-        if (ch == ']') break;
-    }
-
-    return xml;
-}
-string parseValue(stringstream& ss, int level, const string& tag) {
-    char ch;
-    while (ss >> ch) {
-        if (ch == '"') {
-            string val = parseString(ss);
-            return indent(level) + "<" + tag + ">" + val + "</" + tag + ">\n";
-        } else if (isdigit(ch) || ch == '-' || ch == '+') {
-            string num(1, ch);
-            while (ss.peek() != EOF && (isdigit(ss.peek()) || ss.peek() == '.')) {
-                num += ss.get();
-            }
-            return indent(level) + "<" + tag + ">" + num + "</" + tag + ">\n";
-        } else if (ch == 't') { // true
-            ss.ignore(3);
-            return indent(level) + "<" + tag + ">true</" + tag + ">\n";
-        } else if (ch == 'f') { // false
-            ss.ignore(4);
-            return indent(level) + "<" + tag + ">false</" + tag + ">\n";
-        } else if (ch == 'n') { // null
-            ss.ignore(3);
-            return indent(level) + "<" + tag + "/>\n";
-        } else if (ch == '{') {
-            return parseObject(ss, level, tag);
-        } else if (ch == '[') {
-            return parseArray(ss, level, tag);
-        }
+    if (valid && index) {
+        string error;
+        if (!index->write(indexFile, error)) cerr << error << endl;
     }
-    return "";
-}
-string parseJSONtoXML(stringstream& ss, int level, const string& currentTag) {
-    string xml;
-    char ch;
 
-    while (ss >> ch) {
-        if (ch == '{') {
-            xml += parseObject(ss, level, currentTag);
-        } else if (ch == '[') {
-            xml += parseArray(ss, level, currentTag);
-        }
+    if (jsontoxml::traceLevel > 0) jsontoxml::dumpTrace(traceFile);
+    if (statsFormat == "text") stats.print(cerr);
+    else if (statsFormat == "json") stats.print_json(cerr);
+    if (cache && !statsFormat.empty()) {
+        cerr << "cache: " << cache->hits() << " hits, " << cache->misses() << " misses" << endl;
     }
-    return xml;
+    return outputFailed ? 1 : 0;
 }
-
-
-
-int main(int argc, char* argv[]) {
-    string inputFile = "json.text";
-    
-    if (argc > 1) { 
-        inputFile = argv[1];
-    }
-
-    vector<string> requiredFiles = {"tokens.txt", "grammar.txt"};
-    for (const string& file : requiredFiles) {
-        ifstream check(file);
-        if (!check) {
-            cerr << "Error: Required file '" << file << "' not found!" << endl;
-            return 1;
-        }
-        check.close();
-    }
-
-    ifstream checkInput(inputFile);
-    if (!checkInput) {
-        cerr << "Error: Input file '" << inputFile << "' not found!" << endl;
-        return 1;
-    }
-    checkInput.close();
-
-    vector<TokenRule> rules = loadTokenRules("tokens.txt");
-    scanInput(inputFile, rules, "scanner_output.txt");
-
-    readGrammar("grammar.txt");
-    computeFirst();
-    computeFollow();
-    writeSetToFile("first.txt", firstSets, "firsts");
-    writeSetToFile("follow.txt", followSets, "follows");
-    cout << "FIRST and FOLLOW sets written to first.txt and follow.txt." << endl;
-
-    ParsingTable tab1("first.txt", "follow.txt", "grammar.txt");
-    tab1.build_parsing_table("parse_table.txt");
-    cout << "parsing table is done!" << endl;
-
-    LL1_parser pars("scanner_output.txt","parse_table.txt","grammar.txt");
-    pars.check_parser("output.txt");
-    
-    if (valid) {
-        ifstream input(inputFile);
-        if (!input) {
-            cerr << "Error: " << inputFile << " not found\n";
-            return 1;
-        }
-
-        stringstream buffer;
-        buffer << input.rdbuf();
-        input.close();
-
-        string xml = parseJSONtoXML(buffer, 0, "root");
-
-        cout << xml;
-
-        ofstream output("xml.txt");
-        output << xml;
-        output.close();
-    }
-    return 0;
-}
\ No newline at end of file
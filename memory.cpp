@@ -0,0 +1,126 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+DocumentArena::DocumentArena(pmr::memory_resource* upstream, size_t block_size)
+    : upstream(upstream ? upstream : pmr::get_default_resource()), block_size(block_size) {}
+
+DocumentArena::~DocumentArena() {
+    for (const Block& b : blocks) upstream->deallocate(b.data, b.size, alignof(max_align_t));
+}
+
+void DocumentArena::reset() {
+    current = 0;
+    used = 0;
+}
+
+size_t DocumentArena::capacity() const {
+    size_t total = 0;
+    for (const Block& b : blocks) total += b.size;
+    return total;
+}
+
+void* DocumentArena::do_allocate(size_t bytes, size_t alignment) {
+    while (current < blocks.size()) {
+        Block& b = blocks[current];
+        size_t start = (used + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= b.size) {
+            used = start + bytes;
+            return b.data + start;
+        }
+        current++;
+        used = 0;
+    }
+    // out of blocks: grow geometrically so a big document needs few of them
+    size_t size = max(block_size, bytes + alignment);
+    block_size *= 2;
+    char* data = static_cast<char*>(upstream->allocate(size, alignof(max_align_t)));
+    blocks.push_back({data, size});
+    current = blocks.size() - 1;
+    size_t start = (reinterpret_cast<uintptr_t>(data) % alignment) ? alignment - reinterpret_cast<uintptr_t>(data) % alignment : 0;
+    used = start + bytes;
+    return data + start;
+}
+
+CountingResource::CountingResource(pmr::memory_resource* upstream)
+    : upstream(upstream ? upstream : pmr::get_default_resource()) {}
+
+void* CountingResource::do_allocate(size_t n, size_t alignment) {
+    allocations++;
+    bytes += n;
+    return upstream->allocate(n, alignment);
+}
+
+void CountingResource::do_deallocate(void* p, size_t n, size_t alignment) {
+    deallocations++;
+    upstream->deallocate(p, n, alignment);
+}
+
+InputBuffer::InputBuffer(const char* data, size_t len) {
+    char* p = const_cast<char*>(data);
+    setg(p, p, p + len);
+}
+
+InputBuffer::pos_type InputBuffer::seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode which) {
+    if (!(which & ios_base::in)) return pos_type(off_type(-1));
+    off_type base = dir == ios_base::beg ? 0 : dir == ios_base::cur ? gptr() - eback() : egptr() - eback();
+    off_type pos = base + off;
+    if (pos < 0 || pos > egptr() - eback()) return pos_type(off_type(-1));
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+}
+
+InputBuffer::pos_type InputBuffer::seekpos(pos_type pos, ios_base::openmode which) {
+    return seekoff(off_type(pos), ios_base::beg, which);
+}
+
+MappedFile::~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped) munmap(mapped, length);
+#endif
+}
+
+bool MappedFile::open(const string& path, string& error) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Error: Input file '" + path + "' not found!";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            mapped = (char*)p;
+            length = size_t(st.st_size);
+            madvise(p, length, MADV_SEQUENTIAL);
+            close(fd);
+            return true;
+        }
+    }
+    close(fd);
+#endif
+    ifstream in(path, ios::binary);
+    if (!in) {
+        error = "Error: Input file '" + path + "' not found!";
+        return false;
+    }
+    stringstream buffer;
+    buffer << in.rdbuf();
+    copy = buffer.str();
+    return true;
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef JSONTOXML_MEMORY_H
+#define JSONTOXML_MEMORY_H
+
+#include <memory_resource>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace jsontoxml {
+
+// Monotonic per-document arena. deallocate() is a no-op; reset() rewinds to
+// the first block and keeps every block, so once the arena has grown to fit
+// the largest document, later documents allocate nothing from upstream.
+class DocumentArena : public std::pmr::memory_resource {
+public:
+    explicit DocumentArena(std::pmr::memory_resource* upstream = nullptr, size_t block_size = 64 * 1024);
+    ~DocumentArena();
+    DocumentArena(const DocumentArena&) = delete;
+    DocumentArena& operator=(const DocumentArena&) = delete;
+
+    // Everything allocated from the arena must be dead before this is called.
+    void reset();
+    size_t capacity() const;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    struct Block {
+        char* data;
+        size_t size;
+    };
+    std::pmr::memory_resource* upstream;
+    std::vector<Block> blocks;
+    size_t block_size;
+    size_t current = 0;
+    size_t used = 0;
+};
+
+// Passes everything through to `upstream` and counts it; handy as the
+// arena's upstream when checking that steady-state conversions stop allocating.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = nullptr);
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t bytes = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource* upstream;
+};
+
+// A whole file mapped read-only, so output can refer to its bytes without
+// copying them. Where mmap is unavailable, or for files that cannot be
+// mapped such as pipes, the file is read into memory instead.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    const char* data() const { return mapped ? mapped : copy.data(); }
+    size_t size() const { return mapped ? length : copy.size(); }
+
+private:
+    char* mapped = nullptr;
+    size_t length = 0;
+    std::string copy;
+};
+
+// Read-only streambuf over caller memory, so the input can be read through an
+// istream without first being copied into a stringstream.
+class InputBuffer : public std::streambuf {
+public:
+    InputBuffer(const char* data, size_t len);
+    // Direct access for readers that want to scan ahead without going
+    // through the istream a character at a time.
+    const char* cursor() const { return gptr(); }
+    const char* limit() const { return egptr(); }
+    void seek_to(const char* p) { setg(eback(), const_cast<char*>(p), egptr()); }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "parallel_write.h"
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "converter.h"
+#include "memory.h"
+#include "projection.h"
+using namespace std;
+
+namespace jsontoxml {
+
+namespace {
+// A piece of the output: literal text, or the conversion of the value (or,
+// for an element, the array element) spanning [begin, end).
+struct Segment {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    int level = 0;
+    string_view tag;
+    bool element = false;
+    string text;
+};
+
+class Splitter {
+public:
+    Splitter(size_t grain, vector<Segment>& segments) : grain(grain), segments(segments) {}
+
+    // parseValue of the value at [p, end)
+    void value(const char* p, const char* end, int level, string_view tag) {
+        p = skipSpace(p, end);
+        if (size_t(end - p) <= grain || (*p != '{' && *p != '[')) {
+            segments.push_back({p, end, level, tag, false, string()});
+        } else if (*p == '{') {
+            literal(level, "<", tag, ">\n");
+            for (p++;;) {
+                p = skipSpace(p, end);
+                if (p == end || *p == '}') break;
+                // the key as parseString reads it: up to the next quote
+                const char* close = (const char*)memchr(p + 1, '"', end - p - 1);
+                if (!close) break;
+                string_view key(p + 1, close - p - 1);
+                p = (const char*)memchr(close, ':', end - close);
+                if (!p) break;
+                const char* next = skipRawValue(p + 1, end);
+                value(p + 1, next, level + 1, key);
+                p = skipSpace(next, end);
+                if (p < end && *p == ',') p++;
+            }
+            literal(level, "</", tag, ">\n");
+        } else {
+            for (p++;;) {
+                p = skipSpace(p, end);
+                if (p == end || *p == ']') break;
+                const char* next = skipRawValue(p, end);
+                element(p, next, level, tag);
+                p = skipSpace(next, end);
+                if (p < end && *p == ',') p++;
+            }
+        }
+    }
+
+private:
+    // parseArrayElement of the element at [p, end)
+    void element(const char* p, const char* end, int level, string_view tag) {
+        if (size_t(end - p) <= grain) {
+            segments.push_back({p, end, level, tag, true, string()});
+            return;
+        }
+        literal(level, "<", tag, ">\n");
+        value(p, end, level + 1, "item");
+        literal(level, "</", tag, ">\n");
+    }
+    void literal(int level, const char* open, string_view tag, const char* close) {
+        Segment segment;
+        segment.text.assign(level * 2, ' ');
+        segment.text.append(open).append(tag).append(close);
+        segments.push_back(move(segment));
+    }
+    static const char* skipSpace(const char* p, const char* end) {
+        while (p < end && isspace((unsigned char)*p)) p++;
+        return p;
+    }
+
+    size_t grain;
+    vector<Segment>& segments;
+};
+
+// Runs fn(0) ... fn(count - 1) on up to `threads` threads.
+template <typename Fn>
+void forEach(size_t count, size_t threads, Fn fn) {
+    atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i; (i = next++) < count;) fn(i);
+    };
+    vector<thread> pool;
+    for (size_t t = 1; t < min(threads, count); t++) pool.emplace_back(work);
+    work();
+    for (thread& t : pool) t.join();
+}
+}
+
+bool writeParallel(const char* in, size_t len, const string& path, size_t workers, Stats* stats,
+                   uint64_t& bytes, string& error) {
+    if (!workers) workers = max(1u, thread::hardware_concurrency());
+    size_t grain = max<size_t>(64 * 1024, len / (workers * 8));
+
+    // Tasks are runs of consecutive segments covering about `grain` bytes of input.
+    vector<Segment> segments;
+    vector<size_t> taskStart;
+    vector<pmr::string> outputs;
+    vector<uint64_t> offsets;
+    {
+        StageTimer timer(stats, "emit", len);
+        const char* p = in;
+        while (p < in + len && isspace((unsigned char)*p)) p++;
+        // a top-level scalar produces no XML
+        if (p < in + len && (*p == '{' || *p == '[')) Splitter(grain, segments).value(p, in + len, 0, "root");
+        size_t covered = grain;
+        for (size_t s = 0; s < segments.size(); s++) {
+            if (covered >= grain) {
+                taskStart.push_back(s);
+                covered = 0;
+            }
+            covered += segments[s].end - segments[s].begin;
+        }
+        taskStart.push_back(segments.size());
+        size_t tasks = taskStart.size() - 1;
+
+        // phase one: convert, learning each task's size
+        outputs.resize(tasks);
+        forEach(tasks, workers, [&](size_t t) {
+            XmlOutput xml;
+            for (size_t s = taskStart[t]; s < taskStart[t + 1]; s++) {
+                const Segment& segment = segments[s];
+                if (!segment.begin) {
+                    xml += segment.text;
+                    continue;
+                }
+                InputBuffer input(segment.begin, segment.end - segment.begin);
+                istream ss(&input);
+                if (segment.element) parseArrayElement(ss, xml, segment.level, segment.tag);
+                else parseValue(ss, xml, segment.level, segment.tag);
+            }
+            outputs[t] = move(xml.data);
+        });
+        offsets.assign(tasks + 1, 0);
+        for (size_t t = 0; t < tasks; t++) offsets[t + 1] = offsets[t] + outputs[t].size();
+        bytes = offsets[tasks];
+        timer.bytes_out = bytes;
+    }
+
+    // phase two: one allocation at the final size, then every task writes its own range
+    StageTimer timer(stats, "write_output", bytes);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "Error: Cannot open output file '" + path + "': " + strerror(errno);
+        return false;
+    }
+#ifdef __linux__
+    if (bytes && fallocate(fd, 0, 0, off_t(bytes)) != 0 && errno != EOPNOTSUPP && errno != ENOSYS) {
+        error = "Error: Cannot allocate " + to_string(bytes) + " bytes for '" + path + "': " + strerror(errno);
+        close(fd);
+        return false;
+    }
+#endif
+    mutex lock;
+    string failure;
+    forEach(outputs.size(), workers, [&](size_t t) {
+        const char* data = outputs[t].data();
+        size_t size = outputs[t].size(), done = 0;
+        while (done < size) {
+            ssize_t n = pwrite(fd, data + done, size - done, off_t(offsets[t] + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                lock_guard<mutex> guard(lock);
+                if (failure.empty()) failure = "Error: Cannot write '" + path + "': " + strerror(n < 0 ? errno : EIO);
+                return;
+            }
+            done += size_t(n);
+        }
+        pmr::string().swap(outputs[t]); // written; give the memory back early
+    });
+    if (close(fd) != 0 && failure.empty()) failure = "Error: Cannot write '" + path + "': " + strerror(errno);
+    error = failure;
+    return failure.empty();
+}
+
+}
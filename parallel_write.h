@@ -0,0 +1,29 @@
+#ifndef JSONTOXML_PARALLEL_WRITE_H
+#define JSONTOXML_PARALLEL_WRITE_H
+
+#include <cstdint>
+#include <string>
+
+#include "stats.h"
+
+namespace jsontoxml {
+
+// Converts a validated document on `workers` threads (0 picks one per core)
+// and writes the XML to `path`, byte for byte what parseJSONtoXML produces.
+//
+// The document is cut into segments along its containers: an object or
+// array too large for one task is opened and its members or elements
+// become segments of their own, with its tags as literal segments in
+// between. Consecutive segments are grouped into tasks of similar input
+// size. In the first phase each task converts its segments into a buffer
+// of its own, which gives its exact output size; the prefix sums of those
+// sizes are the tasks' file offsets. In the second phase the file is
+// allocated once at its final size and every task's buffer is written at
+// its offset with pwrite(), in parallel, so no thread waits for the one
+// before it to finish writing.
+bool writeParallel(const char* in, size_t len, const std::string& path, size_t workers, Stats* stats,
+                   uint64_t& bytes, std::string& error);
+
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "parser.h"
+
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include "probes.h"
+#include "trace.h"
+using namespace std;
+
+namespace jsontoxml {
+
+static const string end_marker = "$";
+
+LL1_parser::LL1_parser(const Grammar& grm, const vector<Predictive_table>& table,
+                       const map<string, set<string>>& follow, RuleTable::Layout layout)
+    : grammar(grm), layout(layout), follow(follow){
+    load_predictive_table(table);
+}
+void LL1_parser::load_predictive_table(const vector<Predictive_table>& table){
+    set<pair<string, string>> rules_check;
+    startsymbol = grammar.startsymbol;
+    JTX_TRACE(TRACE_INFO, EV_START_SYMBOL, startsymbol, "", 0);
+    predictive_table.clear();
+    rule_symbols.clear();
+    nonterminal_ids.clear();
+    column_ids.clear();
+    for(const string& nt : grammar.nonterminals) nonterminal_ids.emplace(nt, int(nonterminal_ids.size()));
+    for(const string& t : grammar.terminals) column_ids.emplace(t, int(column_ids.size()));
+    nonterminal_count = nonterminal_ids.size();
+    terminal_count = column_ids.size();
+    column_ids.emplace(end_marker, int(column_ids.size()));
+    vector<RuleEntry> entries;
+    for(const Predictive_table& entry : table){
+        if (rules_check.count({entry.nonterminal, entry.first})) {
+            cerr << "Error: Conflict in parse table at (" << entry.nonterminal << "," << entry.first << ")" << endl;
+            loaded = false;
+            return;
+        }
+        rules_check.insert({entry.nonterminal, entry.first});
+        predictive_table.push_back(entry);
+        vector<string> symbols;
+        for (const string& sym : split_rule(entry.rule)) symbols.push_back(remove_spaces(sym));
+        rule_symbols.push_back(symbols);
+        auto row = nonterminal_ids.emplace(entry.nonterminal, int(nonterminal_ids.size())).first;
+        auto column = column_ids.emplace(entry.first, int(column_ids.size())).first;
+        entries.push_back({row->second, column->second, int(rule_symbols.size() - 1)});
+    }
+    rules.build(nonterminal_ids.size(), column_ids.size(), entries, layout);
+}
+bool LL1_parser::check_parser(const TokenList& input){
+    begin();
+    for(const Token& token : input){
+        if(!feed(token.name)){
+            return false;
+        }
+    }
+    return finish();
+}
+bool LL1_parser::check_parser(Generator<Token>& input){
+    begin();
+    for(Token& token : input){
+        if(!feed(token.name)){
+            return false;
+        }
+    }
+    return finish();
+}
+static int nesting(string_view token){
+    return token == "{" || token == "[" ? 1 : token == "}" || token == "]" ? -1 : 0;
+}
+static string describe(const Token* token){
+    return token ? "'" + string(token->value) + "'" : "end of input";
+}
+bool LL1_parser::check_parser(Generator<Token>& input, Diagnostics& diagnostics){
+    begin();
+    auto next = input.begin();
+    size_t errors = 0;
+    int quiet = 0; // tokens still to be matched before another error is reported
+    size_t offset = 0; // of the token in hand, or the end of the last one at the end of input
+    auto report = [&](const Token* token, string message, vector<string> expected){
+        errors++;
+        bool silent = quiet > 0;
+        quiet = 3;
+        if(silent) return;
+        if(token) offset = token->offset;
+        diagnostics.add({offset, 0, 0, move(message), move(expected)});
+    };
+    while(!diagnostics.full()){
+        const Token* token = next != input.end() ? &*next : nullptr;
+        string_view top_i = token ? string_view(token->name) : string_view(end_marker);
+        const string& top_r = *temp_stack.back();
+        JTX_TRACE(TRACE_STEP, EV_PARSE_STEP, top_r, top_i, temp_stack.size());
+
+        if(top_r == end_marker){
+            if(token) report(token, "Unexpected " + describe(token) + " after the end of the document", {end_marker});
+            break;
+        } else if(top_r == "e"){
+            temp_stack.pop_back();
+        } else if(is_terminal(top_r)){
+            temp_stack.pop_back();
+            if(top_r == top_i){
+                offset = token->offset + token->value.size();
+                if(quiet > 0) quiet--;
+                ++next;
+            } else{
+                // carry on as if the missing token had been there
+                report(token, "Expected '" + top_r + "' but found " + describe(token), {top_r});
+            }
+        } else if(const vector<string>* rule = get_rule(top_r, top_i)){
+            temp_stack.pop_back();
+            for(auto it = rule->rbegin(); it != rule->rend(); ++it){
+                temp_stack.push_back(&*it);
+            }
+            if(temp_stack.size() > peak_depth) peak_depth = temp_stack.size();
+        } else{
+            report(token, "Unexpected " + describe(token) + " in " + top_r, expected_terminals(top_r));
+            auto sync = follow.find(top_r);
+            if(!token || (sync != follow.end() && sync->second.count(string(top_i)))){
+                temp_stack.pop_back();
+            } else{
+                // skip a bracketed value whole, so its closing bracket cannot close an outer one
+                int depth = 0;
+                do{
+                    depth += nesting(next->name);
+                    ++next;
+                } while(depth > 0 && next != input.end());
+            }
+        }
+    }
+    if(errors){
+        JTX_TRACE(TRACE_INFO, EV_PARSE_REJECTED, *temp_stack.back(), "", errors);
+        return false;
+    }
+    JTX_TRACE(TRACE_INFO, EV_PARSE_ACCEPTED, "", "", 0);
+    return true;
+}
+void LL1_parser::begin(){
+    temp_stack.clear();
+    temp_stack.push_back(&end_marker);
+    temp_stack.push_back(&startsymbol);
+    peak_depth = temp_stack.size();
+}
+bool LL1_parser::feed(string_view top_i){
+    // Token names come from std::string storage, so data() is NUL-terminated for the probes.
+    while(*temp_stack.back()!="$"){
+        const string& top_r=*temp_stack.back();
+        JTX_TRACE(TRACE_STEP, EV_PARSE_STEP, top_r, top_i, temp_stack.size());
+
+        if(is_terminal(top_r)){
+            if(top_r==top_i){
+                temp_stack.pop_back();
+                return true;
+            }
+            JTX_TRACE(TRACE_INFO, EV_PARSE_REJECTED, top_r, top_i, temp_stack.size());
+            JTX_PROBE3(parse_error, top_r.c_str(), top_i.data(), temp_stack.size());
+            return false;
+        } else if(is_nonterminal(top_r)){
+            const vector<string>* rule = get_rule(top_r,top_i);
+            if(rule){
+                temp_stack.pop_back();
+                for (auto it = rule->rbegin(); it != rule->rend(); ++it){
+                    temp_stack.push_back(&*it);
+                }
+                if(temp_stack.size() > peak_depth) peak_depth = temp_stack.size();
+            } else{
+                JTX_TRACE(TRACE_INFO, EV_PARSE_REJECTED, top_r, top_i, temp_stack.size());
+                JTX_PROBE3(parse_error, top_r.c_str(), top_i.data(), temp_stack.size());
+                return false;
+            }
+        } else if(top_r=="e"){
+            temp_stack.pop_back();
+        } else {
+            JTX_TRACE(TRACE_INFO, EV_PARSE_REJECTED, top_r, top_i, temp_stack.size());
+            JTX_PROBE3(parse_error, top_r.c_str(), top_i.data(), temp_stack.size());
+            return false;
+        }
+    }
+    return top_i=="$";
+}
+bool LL1_parser::finish(){
+    if(feed("$")){
+        JTX_TRACE(TRACE_INFO, EV_PARSE_ACCEPTED, "", "", 0);
+        return true;
+    }
+    JTX_TRACE(TRACE_INFO, EV_PARSE_REJECTED, *temp_stack.back(), "$", temp_stack.size());
+    return false;
+}
+bool LL1_parser::is_terminal(string_view term) const{
+    auto it = column_ids.find(term);
+    return it != column_ids.end() && size_t(it->second) < terminal_count;
+}
+bool LL1_parser::is_nonterminal(string_view nterm) const{
+    auto it = nonterminal_ids.find(nterm);
+    return it != nonterminal_ids.end() && size_t(it->second) < nonterminal_count;
+}
+vector<string> LL1_parser::expected_terminals(string_view nonterminal) const{
+    vector<string> result;
+    for(const Predictive_table& t : predictive_table){
+        if(t.nonterminal == nonterminal) result.push_back(t.first);
+    }
+    return result;
+}
+const vector<string>* LL1_parser::get_rule(string_view nonterminal,string_view terminal) const{
+    auto row = nonterminal_ids.find(nonterminal);
+    auto column = column_ids.find(terminal);
+    if(row != nonterminal_ids.end() && column != column_ids.end()){
+        int i = rules.lookup(row->second, column->second);
+        if(i != RuleTable::NONE){
+            JTX_TRACE(TRACE_STEP, EV_RULE_MATCH, string(nonterminal) + "," + string(terminal), predictive_table[i].rule, 0);
+            return &rule_symbols[i];
+        }
+    }
+    JTX_TRACE(TRACE_STEP, EV_RULE_MISSING, nonterminal, terminal, 0);
+    return nullptr;
+}
+vector<string> LL1_parser::split_rule(const string& rule) {
+    stringstream ss(rule);
+    string sym;
+    vector<string> result;
+    while (ss >> sym) result.push_back(sym);
+    return result;
+}
+string LL1_parser::remove_spaces(const string& str) {
+    string result = "";
+    for (char c : str) {
+        if (c != ' ')
+            result += c;
+    }
+    return result;
+}
+
+}
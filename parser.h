@@ -0,0 +1,82 @@
+#ifndef JSONTOXML_PARSER_H
+#define JSONTOXML_PARSER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "grammar.h"
+#include "rule_table.h"
+#include "scanner.h"
+
+namespace jsontoxml {
+
+// parser LL-1
+class LL1_parser{
+    private:
+    Grammar grammar;
+    // The parse stack holds pointers into rule_symbols (and startsymbol/end_marker),
+    // so pushing a production never copies or allocates strings.
+    std::vector<const std::string*> temp_stack;
+    std::string startsymbol="";
+    std::vector<Predictive_table> predictive_table;
+    // Right-hand side of each predictive_table entry, already split into symbols.
+    std::vector<std::vector<std::string>> rule_symbols;
+    // Symbol ids for the rule table: lookahead columns are the grammar's
+    // terminals, then "$", then any other symbol the table names.
+    struct SymbolHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+    };
+    std::unordered_map<std::string, int, SymbolHash, std::equal_to<>> nonterminal_ids, column_ids;
+    size_t terminal_count = 0, nonterminal_count = 0;
+    RuleTable rules;
+    RuleTable::Layout layout = RuleTable::AUTO;
+    // FOLLOW set of each nonterminal, where error recovery resynchronizes.
+    std::map<std::string, std::set<std::string>> follow;
+    bool loaded = true;
+    size_t peak_depth = 0;
+
+    public:
+    LL1_parser() = default;
+    LL1_parser(const Grammar& grm, const std::vector<Predictive_table>& table,
+               const std::map<std::string, std::set<std::string>>& follow = {},
+               RuleTable::Layout layout = RuleTable::AUTO);
+    bool is_loaded() const { return loaded; }
+    // Deepest the parse stack got since the last begin().
+    size_t get_peak_depth() const { return peak_depth; }
+    const RuleTable& get_rule_table() const { return rules; }
+    void load_predictive_table(const std::vector<Predictive_table>& table);
+    // Runs the predictive parse over `input`; true when the token stream is accepted.
+    bool check_parser(const TokenList& input);
+    // Pulls tokens from the generator one at a time, so the scanner only runs
+    // as far ahead as the parse has got.
+    bool check_parser(Generator<Token>& input);
+    // Panic-mode form: instead of stopping at the first error it records it,
+    // then either pops the nonterminal being expanded when the token is in
+    // its FOLLOW set or skips the token, and carries on to the end of the
+    // input or the diagnostics limit. Like yacc, it stays quiet until three
+    // tokens have been matched since the last error, so one mistake does not
+    // cascade into several reports. True when nothing was wrong.
+    bool check_parser(Generator<Token>& input, Diagnostics& diagnostics);
+    // Incremental form of check_parser: begin(), feed() every token in order,
+    // then finish(). feed() returns false as soon as the input is rejected.
+    void begin();
+    bool feed(std::string_view token);
+    bool finish();
+    bool is_terminal(std::string_view term) const;
+    bool is_nonterminal(std::string_view nterm) const;
+    // Terminals with a table entry for `nonterminal`.
+    std::vector<std::string> expected_terminals(std::string_view nonterminal) const;
+    // Symbols of the rule for (nonterminal, terminal), or nullptr when the table has none.
+    const std::vector<std::string>* get_rule(std::string_view nonterminal,std::string_view terminal) const;
+    std::vector<std::string> split_rule(const std::string& rule);
+    std::string remove_spaces(const std::string& str);
+};
+
+}
+
+#endif
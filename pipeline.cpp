@@ -0,0 +1,131 @@
+#include "pipeline.h"
+
+#include <istream>
+#include <thread>
+
+#include "converter.h"
+#include "memory.h"
+#include "projection.h"
+#include "spsc_ring.h"
+#include "xml_index.h"
+using namespace std;
+
+namespace jsontoxml {
+
+static const size_t TOKEN_BLOCK = 512;
+static const size_t OUTPUT_BLOCK = 64 * 1024;
+
+bool convertPipelined(const char* in, size_t len, const vector<TokenRule>& rules,
+                      LL1_parser& parser, const Options& options, Sink& out, string& error) {
+    SpscRing<TokenList> tokenRing(64);
+    SpscRing<pmr::string> outputRing(16);
+    bool scanned = false, accepted = false;
+    string scanError;
+
+    thread scanner([&]() {
+        TokenList block;
+        block.reserve(TOKEN_BLOCK);
+        scanned = scanInput(in, len, rules, [&](Token&& token) {
+            block.push_back(move(token));
+            if (block.size() == TOKEN_BLOCK) {
+                tokenRing.push(move(block));
+                block = TokenList();
+                block.reserve(TOKEN_BLOCK);
+            }
+        }, scanError);
+        if (!block.empty()) tokenRing.push(move(block));
+        tokenRing.close();
+    });
+
+    thread validator([&]() {
+        TokenList block;
+        bool ok = true;
+        parser.begin();
+        // keep draining after a rejection so the scanner never blocks on a full ring
+        while (tokenRing.pop(block)) {
+            for (size_t i = 0; ok && i < block.size(); i++) {
+                ok = parser.feed(block[i].name);
+            }
+        }
+        accepted = ok && parser.finish();
+    });
+
+    thread writer([&]() {
+        pmr::string block;
+        while (outputRing.pop(block)) {
+            out.write(block.data(), block.size());
+        }
+    });
+
+    InputBuffer input(in, len);
+    istream buffer(&input);
+    XmlOutput xml;
+    xml.block_size = OUTPUT_BLOCK;
+    xml.flush = [&outputRing](pmr::string& data) {
+        outputRing.push(move(data));
+        data.clear();
+    };
+    xml.observer = options.index;
+    if (options.select) projectJSONtoXML(buffer, xml, *options.select, 0, "root");
+    else parseJSONtoXML(buffer, xml, 0, "root");
+    outputRing.close();
+
+    scanner.join();
+    validator.join();
+    writer.join();
+
+    if (!scanned) {
+        error = scanError;
+        return false;
+    }
+    if (!accepted) {
+        error = "Error: Input rejected by the LL(1) parser";
+        return false;
+    }
+    return true;
+}
+
+bool convertStreaming(const char* in, size_t len, const vector<TokenRule>& rules,
+                      LL1_parser& parser, const Options& options, Sink& out, string& error) {
+    string scanError;
+    Generator<Token> tokens = scanTokens(in, len, rules, scanError);
+    Generator<Token>::iterator token = tokens.begin();
+    bool ok = true;
+    parser.begin();
+
+    // validate every token that starts before `pos`
+    auto validateTo = [&](size_t pos) {
+        while (ok && token != tokens.end() && token->offset < pos) {
+            ok = parser.feed(token->name);
+            ++token;
+        }
+    };
+
+    InputBuffer input(in, len);
+    istream buffer(&input);
+    XmlOutput xml;
+    xml.block_size = 1;
+    xml.flush = [&](pmr::string& data) {
+        streamoff pos = buffer.tellg();
+        validateTo(pos < 0 ? len : (size_t)pos);
+        if (ok) out.write(data.data(), data.size());
+        data.clear();
+    };
+    xml.observer = options.index;
+    if (options.select) projectJSONtoXML(buffer, xml, *options.select, 0, "root");
+    else parseJSONtoXML(buffer, xml, 0, "root");
+
+    validateTo(len);
+    bool accepted = ok && parser.finish();
+    if (!scanError.empty()) {
+        error = scanError;
+        return false;
+    }
+    if (!accepted) {
+        error = "Error: Input rejected by the LL(1) parser";
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,29 @@
+#ifndef JSONTOXML_PIPELINE_H
+#define JSONTOXML_PIPELINE_H
+
+#include <string>
+#include <vector>
+
+#include "jsontoxml.h"
+#include "parser.h"
+#include "scanner.h"
+
+namespace jsontoxml {
+
+// Runs the scanner, the LL(1) validator and the Sink writer on their own
+// threads, connected by SPSC rings, while the calling thread generates XML.
+// Output reaches `out` before validation has finished, so on a false return
+// the sink may already hold part of the document.
+bool convertPipelined(const char* in, size_t len, const std::vector<TokenRule>& rules,
+                      LL1_parser& parser, const Options& options, Sink& out, std::string& error);
+
+// Single-threaded pull pipeline. The converter drives: before each finished
+// XML element is written, the LL(1) parser pulls tokens from the lazy scanner
+// up to the input position the element ended at. Only one token is live at a
+// time and output never runs ahead of the validated input.
+bool convertStreaming(const char* in, size_t len, const std::vector<TokenRule>& rules,
+                      LL1_parser& parser, const Options& options, Sink& out, std::string& error);
+
+}
+
+#endif
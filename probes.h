@@ -0,0 +1,72 @@
+#ifndef JSONTOXML_PROBES_H
+#define JSONTOXML_PROBES_H
+
+// Static USDT probe points for perf and bpftrace, without depending on
+// systemtap's <sys/sdt.h>. Each probe is a single nop plus a .note.stapsdt
+// ELF note in the same format sdt.h emits, so an idle probe costs one nop
+// and a few register moves. Arguments are passed as 64-bit values; strings
+// are passed as pointers (read them with str(argN) in bpftrace).
+//
+// Probes (provider "jsontoxml"):
+//   doc_start(bytes_in)
+//   doc_end(bytes_in, bytes_out, duration_ns, ok)
+//   stage_start(stage_name, bytes_in)
+//   stage_end(stage_name, bytes_in, bytes_out, duration_ns)
+//   scan_error(line)
+//   parse_error(stack_top, token, stack_depth)
+//
+// Define JSONTOXML_NO_PROBES to compile them out.
+
+#include <cstdint>
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__)) && !defined(JSONTOXML_NO_PROBES)
+
+#define JTX_PROBE_ARG(x) ((uint64_t)(x))
+
+#define JTX_PROBE_ASM(name, args, ...) \
+    __asm__ __volatile__( \
+        "990: nop\n" \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+        ".balign 4\n" \
+        ".4byte 992f-991f, 994f-993f, 3\n" \
+        "991: .asciz \"stapsdt\"\n" \
+        "992: .balign 4\n" \
+        "993: .8byte 990b\n" \
+        ".8byte _.stapsdt.base\n" \
+        ".8byte 0\n" \
+        ".asciz \"jsontoxml\"\n" \
+        ".asciz \"" #name "\"\n" \
+        ".asciz \"" args "\"\n" \
+        "994: .balign 4\n" \
+        ".popsection\n" \
+        ".ifndef _.stapsdt.base\n" \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n" \
+        ".hidden _.stapsdt.base\n" \
+        "_.stapsdt.base: .space 1\n" \
+        ".size _.stapsdt.base, 1\n" \
+        ".popsection\n" \
+        ".endif\n" \
+        :: __VA_ARGS__)
+
+#define JTX_PROBE1(name, a1) \
+    JTX_PROBE_ASM(name, "8@%[jtx_a1]", [jtx_a1] "r"(JTX_PROBE_ARG(a1)))
+#define JTX_PROBE2(name, a1, a2) \
+    JTX_PROBE_ASM(name, "8@%[jtx_a1] 8@%[jtx_a2]", [jtx_a1] "r"(JTX_PROBE_ARG(a1)), [jtx_a2] "r"(JTX_PROBE_ARG(a2)))
+#define JTX_PROBE3(name, a1, a2, a3) \
+    JTX_PROBE_ASM(name, "8@%[jtx_a1] 8@%[jtx_a2] 8@%[jtx_a3]", [jtx_a1] "r"(JTX_PROBE_ARG(a1)), \
+                  [jtx_a2] "r"(JTX_PROBE_ARG(a2)), [jtx_a3] "r"(JTX_PROBE_ARG(a3)))
+#define JTX_PROBE4(name, a1, a2, a3, a4) \
+    JTX_PROBE_ASM(name, "8@%[jtx_a1] 8@%[jtx_a2] 8@%[jtx_a3] 8@%[jtx_a4]", [jtx_a1] "r"(JTX_PROBE_ARG(a1)), \
+                  [jtx_a2] "r"(JTX_PROBE_ARG(a2)), [jtx_a3] "r"(JTX_PROBE_ARG(a3)), [jtx_a4] "r"(JTX_PROBE_ARG(a4)))
+
+#else
+
+#define JTX_PROBE1(name, a1) do { } while (0)
+#define JTX_PROBE2(name, a1, a2) do { } while (0)
+#define JTX_PROBE3(name, a1, a2, a3) do { } while (0)
+#define JTX_PROBE4(name, a1, a2, a3, a4) do { } while (0)
+
+#endif
+
+#endif
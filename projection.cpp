@@ -0,0 +1,286 @@
+#include "projection.h"
+
+#include <cctype>
+#include <cstring>
+
+#include "memory.h"
+using namespace std;
+
+namespace jsontoxml {
+
+bool PathSelector::add(const string& expr, string& error) {
+    vector<Step> steps;
+    size_t i = 0;
+    if (expr.empty() || expr[0] != '$') {
+        error = "Error: Path '" + expr + "' must start with $";
+        return false;
+    }
+    i++;
+    while (i < expr.size()) {
+        Step step;
+        if (expr[i] == '.') {
+            size_t start = ++i;
+            if (i < expr.size() && expr[i] == '*') {
+                step.kind = Step::ANY;
+                i++;
+            } else {
+                while (i < expr.size() && expr[i] != '.' && expr[i] != '[') i++;
+                if (i == start) break;
+                step.kind = Step::KEY;
+                step.key = expr.substr(start, i - start);
+            }
+        } else if (expr[i] == '[') {
+            size_t close;
+            if (i + 1 < expr.size() && (expr[i + 1] == '\'' || expr[i + 1] == '"')) {
+                close = expr.find(expr[i + 1], i + 2);
+                if (close == string::npos || close + 1 >= expr.size() || expr[close + 1] != ']') break;
+                step.kind = Step::KEY;
+                step.key = expr.substr(i + 2, close - i - 2);
+                i = close + 2;
+            } else {
+                close = expr.find(']', i);
+                if (close == string::npos) break;
+                string inside = expr.substr(i + 1, close - i - 1);
+                if (inside == "*") {
+                    step.kind = Step::ANY;
+                } else if (!inside.empty() && inside.find_first_not_of("0123456789") == string::npos) {
+                    step.kind = Step::INDEX;
+                    step.index = stoul(inside);
+                } else {
+                    break;
+                }
+                i = close + 1;
+            }
+        } else {
+            break;
+        }
+        steps.push_back(step);
+    }
+    if (i < expr.size() || steps.size() > 0xffff || paths.size() > 0xffff) {
+        error = "Error: Unsupported path '" + expr + "' (use $, .key, ['key'], .*, [*] or [N])";
+        return false;
+    }
+    paths.push_back(steps);
+    if (!source.empty()) source += ',';
+    source += expr;
+    return true;
+}
+
+PathSelector::Match PathSelector::start(State& state) const {
+    state.clear();
+    for (size_t p = 0; p < paths.size(); p++) {
+        if (paths[p].empty()) return FULL;
+        state.push_back(unsigned(p) << 16);
+    }
+    return state.empty() ? NONE : PARTIAL;
+}
+
+PathSelector::Match PathSelector::advance(const State& in, bool is_key, string_view key, size_t i, State& out) const {
+    out.clear();
+    for (unsigned entry : in) {
+        const vector<Step>& steps = paths[entry >> 16];
+        size_t pos = entry & 0xffff;
+        const Step& step = steps[pos];
+        bool matched = step.kind == Step::ANY ||
+                       (is_key ? step.kind == Step::KEY && step.key == key
+                               : step.kind == Step::INDEX && step.index == i);
+        if (!matched) continue;
+        if (pos + 1 == steps.size()) return FULL;
+        out.push_back(entry + 1);
+    }
+    return out.empty() ? NONE : PARTIAL;
+}
+
+PathSelector::Match PathSelector::key(const State& in, string_view k, State& out) const {
+    return advance(in, true, k, 0, out);
+}
+
+PathSelector::Match PathSelector::index(const State& in, size_t i, State& out) const {
+    return advance(in, false, string_view(), i, out);
+}
+
+const char* findStringEnd(const char* p, const char* end) {
+    while (p < end) {
+        const char* q = static_cast<const char*>(memchr(p, '"', end - p));
+        if (!q) return end;
+        const char* b = q;
+        while (b > p && b[-1] == '\\') b--;
+        if ((q - b) % 2 == 0) return q;
+        p = q + 1;
+    }
+    return end;
+}
+
+// Strings are crossed with memchr, containers by counting brackets outside strings.
+const char* skipRawValue(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p == end) return end;
+    if (*p == '"') {
+        const char* q = findStringEnd(p + 1, end);
+        return q < end ? q + 1 : end;
+    }
+    if (*p != '{' && *p != '[') {
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && !isspace((unsigned char)*p)) p++;
+        return p;
+    }
+    size_t depth = 0;
+    for (; p < end; p++) {
+        char c = *p;
+        if (c == '"') {
+            p = findStringEnd(p + 1, end);
+            if (p == end) return end;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) return p + 1;
+        }
+    }
+    return end;
+}
+
+void skipValue(istream& ss) {
+    if (InputBuffer* raw = dynamic_cast<InputBuffer*>(ss.rdbuf())) {
+        raw->seek_to(skipRawValue(raw->cursor(), raw->limit()));
+        return;
+    }
+    // generic streams: same walk a character at a time
+    char ch;
+    if (!(ss >> ch)) return;
+    if (ch == '"') {
+        while (ss.get(ch) && ch != '"') {
+            if (ch == '\\') ss.get(ch);
+        }
+        return;
+    }
+    if (ch != '{' && ch != '[') {
+        while (ss.peek() != EOF && !strchr(",}] \t\r\n", ss.peek())) ss.get();
+        return;
+    }
+    size_t depth = 1;
+    while (depth && ss.get(ch)) {
+        if (ch == '"') {
+            while (ss.get(ch) && ch != '"') {
+                if (ch == '\\') ss.get(ch);
+            }
+        } else if (ch == '{' || ch == '[') {
+            depth++;
+        } else if (ch == '}' || ch == ']') {
+            depth--;
+        }
+    }
+}
+
+static void projectValue(istream& ss, XmlOutput& xml, const PathSelector& select,
+                         const PathSelector::State& state, int level, string_view tag);
+
+static void projectObject(istream& ss, XmlOutput& xml, const PathSelector& select,
+                          const PathSelector::State& state, int level, string_view tag) {
+    xml.indent(level);
+    xml += '<';
+    xml += tag;
+    xml += ">\n";
+    pmr::string key(xml.data.get_allocator());
+    PathSelector::State next;
+    char ch;
+
+    while (ss >> ch) {
+        if (ch == '"') {
+            key.clear();
+            parseString(ss, key);
+
+            // skip colon
+            while (ss >> ch && ch != ':');
+
+            PathSelector::Match match = select.key(state, key, next);
+            if (match == PathSelector::NONE) {
+                skipValue(ss);
+                continue;
+            }
+            if (xml.observer) xml.observer->enter_key(key, xml.offset(), inputOffset(ss));
+            if (match == PathSelector::FULL) parseValue(ss, xml, level + 1, key);
+            else projectValue(ss, xml, select, next, level + 1, key);
+            if (xml.observer) xml.observer->leave(xml.offset(), inputOffset(ss));
+        } else if (ch == '}') {
+            break;
+        }
+    }
+
+    xml.indent(level);
+    xml += "</";
+    xml += tag;
+    xml += ">\n";
+    xml.element_done();
+}
+
+static void projectArray(istream& ss, XmlOutput& xml, const PathSelector& select,
+                         const PathSelector::State& state, int level, string_view tag) {
+    PathSelector::State next;
+    size_t i = 0;
+    char ch;
+
+    while (ss >> ch) {
+        if (ch == ']') break;
+        ss.putback(ch);
+
+        PathSelector::Match match = select.index(state, i, next);
+        if (match == PathSelector::NONE) {
+            skipValue(ss);
+        } else {
+            if (xml.observer) xml.observer->enter_index(i, xml.offset(), inputOffset(ss));
+            xml.indent(level);
+            xml += '<';
+            xml += tag;
+            xml += ">\n";
+            if (match == PathSelector::FULL) parseValue(ss, xml, level + 1, "item");
+            else projectValue(ss, xml, select, next, level + 1, "item");
+            xml.indent(level);
+            xml += "</";
+            xml += tag;
+            xml += ">\n";
+            if (xml.observer) xml.observer->leave(xml.offset(), inputOffset(ss));
+            xml.element_done();
+        }
+        i++;
+
+        ss >> ch;
+        if (ch != ',' && ch != ']') ss.putback(ch);
+        if (ch == ']') break;
+    }
+}
+
+static void projectValue(istream& ss, XmlOutput& xml, const PathSelector& select,
+                         const PathSelector::State& state, int level, string_view tag) {
+    char ch;
+    if (!(ss >> ch)) return;
+    if (ch == '{') {
+        projectObject(ss, xml, select, state, level, tag);
+    } else if (ch == '[') {
+        projectArray(ss, xml, select, state, level, tag);
+    } else {
+        // a scalar where the path still expects to go deeper: nothing selected
+        ss.putback(ch);
+        skipValue(ss);
+    }
+}
+
+void projectJSONtoXML(istream& ss, XmlOutput& xml, const PathSelector& select, int level, string_view currentTag) {
+    PathSelector::State state;
+    if (select.start(state) == PathSelector::FULL) {
+        parseJSONtoXML(ss, xml, level, currentTag);
+        return;
+    }
+    char ch;
+
+    if (xml.observer) xml.observer->enter_root(xml.offset(), inputOffset(ss));
+    while (ss >> ch) {
+        if (ch == '{') {
+            projectObject(ss, xml, select, state, level, currentTag);
+        } else if (ch == '[') {
+            projectArray(ss, xml, select, state, level, currentTag);
+        }
+    }
+    if (xml.observer) xml.observer->leave(xml.offset(), inputOffset(ss));
+    xml.finish();
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef JSONTOXML_PROJECTION_H
+#define JSONTOXML_PROJECTION_H
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "converter.h"
+
+namespace jsontoxml {
+
+// A set of JSONPath expressions in a small subset: `$` followed by any of
+// `.key`, `['key']`, `.*`, `[*]` and `[N]`. The converter asks it about every
+// key and array element on the way down, so nothing outside the selection
+// is ever converted.
+class PathSelector {
+public:
+    enum Match { NONE, PARTIAL, FULL };
+    // Live partial matches, each packed as (path index << 16 | next step).
+    typedef std::vector<unsigned> State;
+
+    // Adds one expression; returns false and fills `error` if it is not in the subset.
+    bool add(const std::string& expr, std::string& error);
+    bool empty() const { return paths.empty(); }
+    // The expressions joined with commas, for cache keys.
+    const std::string& text() const { return source; }
+
+    Match start(State& state) const;
+    Match key(const State& in, std::string_view key, State& out) const;
+    Match index(const State& in, size_t i, State& out) const;
+
+private:
+    struct Step {
+        enum Kind { KEY, ANY, INDEX } kind;
+        std::string key;
+        size_t index = 0;
+    };
+    Match advance(const State& in, bool is_key, std::string_view key, size_t i, State& out) const;
+
+    std::vector<std::vector<Step>> paths;
+    std::string source;
+};
+
+// Like parseJSONtoXML, but only the selected subtrees and the elements on
+// the way to them are written. Everything else is skipped by counting
+// brackets and quotes, without being converted.
+void projectJSONtoXML(std::istream& ss, XmlOutput& xml, const PathSelector& select,
+                      int level = 0, std::string_view currentTag = "root");
+// Moves `ss` past one JSON value.
+void skipValue(std::istream& ss);
+// Raw-buffer forms: the end of the value starting at or after `p` (leading
+// whitespace is skipped), and the closing quote of a string whose contents
+// start at `p`. Both return `end` when the input runs out.
+const char* skipRawValue(const char* p, const char* end);
+const char* findStringEnd(const char* p, const char* end);
+
+}
+
+#endif
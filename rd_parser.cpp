@@ -0,0 +1,377 @@
+// Generated by --gen-parser from the LL(1) table of grammar.txt. Do not edit;
+// regenerate it whenever grammar.txt changes.
+#include "rd_parser.h"
+
+#include <string_view>
+using namespace std;
+
+namespace jsontoxml {
+
+const char* const rdGrammarSignature =
+    "start Json\n"
+    "Array [ -> [ ArrayT\n"
+    "ArrayT \" -> Values ]\n"
+    "ArrayT [ -> Values ]\n"
+    "ArrayT false -> Values ]\n"
+    "ArrayT null -> Values ]\n"
+    "ArrayT number -> Values ]\n"
+    "ArrayT true -> Values ]\n"
+    "ArrayT { -> Values ]\n"
+    "ArrayT ] -> ]\n"
+    "Boolean true -> true\n"
+    "Boolean false -> false\n"
+    "Json { -> Object\n"
+    "Json [ -> Array\n"
+    "Member \" -> String : Value\n"
+    "Members \" -> Member MembersT\n"
+    "MembersT , -> , Member MembersT\n"
+    "MembersT } -> e\n"
+    "Null null -> null\n"
+    "Number number -> number\n"
+    "Object { -> { ObjectT\n"
+    "ObjectT \" -> Members }\n"
+    "ObjectT } -> }\n"
+    "String \" -> \" string \"\n"
+    "Value \" -> String\n"
+    "Value number -> Number\n"
+    "Value { -> Object\n"
+    "Value [ -> Array\n"
+    "Value false -> Boolean\n"
+    "Value true -> Boolean\n"
+    "Value null -> Null\n"
+    "Values \" -> Value ValuesT\n"
+    "Values [ -> Value ValuesT\n"
+    "Values false -> Value ValuesT\n"
+    "Values null -> Value ValuesT\n"
+    "Values number -> Value ValuesT\n"
+    "Values true -> Value ValuesT\n"
+    "Values { -> Value ValuesT\n"
+    "ValuesT , -> , Value ValuesT\n"
+    "ValuesT ] -> e\n"
+    "";
+
+namespace {
+
+enum Terminal {
+    T_END,
+    T_1, // {
+    T_2, // }
+    T_3, // [
+    T_4, // ]
+    T_5, // :
+    T_6, // ,
+    T_7, // "
+    T_8, // string
+    T_9, // number
+    T_10, // true
+    T_11, // false
+    T_12, // null
+    T_UNKNOWN
+};
+
+Terminal terminalOf(string_view name) {
+    if (name == "{") return T_1;
+    if (name == "}") return T_2;
+    if (name == "[") return T_3;
+    if (name == "]") return T_4;
+    if (name == ":") return T_5;
+    if (name == ",") return T_6;
+    if (name == "\"") return T_7;
+    if (name == "string") return T_8;
+    if (name == "number") return T_9;
+    if (name == "true") return T_10;
+    if (name == "false") return T_11;
+    if (name == "null") return T_12;
+    return T_UNKNOWN;
+}
+
+struct VectorSource {
+    const Token* at;
+    const Token* end;
+    Terminal next() { return at == end ? T_END : terminalOf((at++)->name); }
+};
+
+struct GeneratorSource {
+    Generator<Token>::iterator at, end;
+    Terminal next() {
+        if (at == end) return T_END;
+        Terminal t = terminalOf(at->name);
+        ++at;
+        return t;
+    }
+};
+
+template <class Source>
+struct Parser {
+    Source src;
+    Terminal la = T_END;
+
+    bool match(Terminal t) {
+        if (la != t) return false;
+        la = src.next();
+        return true;
+    }
+    bool parse_0_Json();
+    bool parse_1_Object();
+    bool parse_2_ObjectT();
+    bool parse_3_Array();
+    bool parse_4_ArrayT();
+    bool parse_5_Members();
+    bool parse_6_MembersT();
+    bool parse_7_Member();
+    bool parse_8_Values();
+    bool parse_9_ValuesT();
+    bool parse_10_Value();
+    bool parse_11_String();
+    bool parse_12_Number();
+    bool parse_13_Boolean();
+    bool parse_14_Null();
+};
+
+// Json
+template <class Source>
+bool Parser<Source>::parse_0_Json() {
+    switch (la) {
+    case T_1: // {
+        // Json -> Object
+        return parse_1_Object();
+    case T_3: // [
+        // Json -> Array
+        return parse_3_Array();
+    default:
+        return false;
+    }
+}
+
+// Object
+template <class Source>
+bool Parser<Source>::parse_1_Object() {
+    switch (la) {
+    case T_1: // {
+        // Object -> { ObjectT
+        return match(T_1) && parse_2_ObjectT();
+    default:
+        return false;
+    }
+}
+
+// ObjectT
+template <class Source>
+bool Parser<Source>::parse_2_ObjectT() {
+    switch (la) {
+    case T_7: // "
+        // ObjectT -> Members }
+        return parse_5_Members() && match(T_2);
+    case T_2: // }
+        // ObjectT -> }
+        return match(T_2);
+    default:
+        return false;
+    }
+}
+
+// Array
+template <class Source>
+bool Parser<Source>::parse_3_Array() {
+    switch (la) {
+    case T_3: // [
+        // Array -> [ ArrayT
+        return match(T_3) && parse_4_ArrayT();
+    default:
+        return false;
+    }
+}
+
+// ArrayT
+template <class Source>
+bool Parser<Source>::parse_4_ArrayT() {
+    switch (la) {
+    case T_7: // "
+    case T_3: // [
+    case T_11: // false
+    case T_12: // null
+    case T_9: // number
+    case T_10: // true
+    case T_1: // {
+        // ArrayT -> Values ]
+        return parse_8_Values() && match(T_4);
+    case T_4: // ]
+        // ArrayT -> ]
+        return match(T_4);
+    default:
+        return false;
+    }
+}
+
+// Members
+template <class Source>
+bool Parser<Source>::parse_5_Members() {
+    switch (la) {
+    case T_7: // "
+        // Members -> Member MembersT
+        return parse_7_Member() && parse_6_MembersT();
+    default:
+        return false;
+    }
+}
+
+// MembersT
+template <class Source>
+bool Parser<Source>::parse_6_MembersT() {
+    for (;;) {
+        switch (la) {
+        case T_6: // ,
+            // MembersT -> , Member MembersT
+            if (!(match(T_6) && parse_7_Member())) return false;
+            continue;
+        case T_2: // }
+            // MembersT -> e
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+// Member
+template <class Source>
+bool Parser<Source>::parse_7_Member() {
+    switch (la) {
+    case T_7: // "
+        // Member -> String : Value
+        return parse_11_String() && match(T_5) && parse_10_Value();
+    default:
+        return false;
+    }
+}
+
+// Values
+template <class Source>
+bool Parser<Source>::parse_8_Values() {
+    switch (la) {
+    case T_7: // "
+    case T_3: // [
+    case T_11: // false
+    case T_12: // null
+    case T_9: // number
+    case T_10: // true
+    case T_1: // {
+        // Values -> Value ValuesT
+        return parse_10_Value() && parse_9_ValuesT();
+    default:
+        return false;
+    }
+}
+
+// ValuesT
+template <class Source>
+bool Parser<Source>::parse_9_ValuesT() {
+    for (;;) {
+        switch (la) {
+        case T_6: // ,
+            // ValuesT -> , Value ValuesT
+            if (!(match(T_6) && parse_10_Value())) return false;
+            continue;
+        case T_4: // ]
+            // ValuesT -> e
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+// Value
+template <class Source>
+bool Parser<Source>::parse_10_Value() {
+    switch (la) {
+    case T_7: // "
+        // Value -> String
+        return parse_11_String();
+    case T_9: // number
+        // Value -> Number
+        return parse_12_Number();
+    case T_1: // {
+        // Value -> Object
+        return parse_1_Object();
+    case T_3: // [
+        // Value -> Array
+        return parse_3_Array();
+    case T_11: // false
+    case T_10: // true
+        // Value -> Boolean
+        return parse_13_Boolean();
+    case T_12: // null
+        // Value -> Null
+        return parse_14_Null();
+    default:
+        return false;
+    }
+}
+
+// String
+template <class Source>
+bool Parser<Source>::parse_11_String() {
+    switch (la) {
+    case T_7: // "
+        // String -> " string "
+        return match(T_7) && match(T_8) && match(T_7);
+    default:
+        return false;
+    }
+}
+
+// Number
+template <class Source>
+bool Parser<Source>::parse_12_Number() {
+    switch (la) {
+    case T_9: // number
+        // Number -> number
+        return match(T_9);
+    default:
+        return false;
+    }
+}
+
+// Boolean
+template <class Source>
+bool Parser<Source>::parse_13_Boolean() {
+    switch (la) {
+    case T_10: // true
+        // Boolean -> true
+        return match(T_10);
+    case T_11: // false
+        // Boolean -> false
+        return match(T_11);
+    default:
+        return false;
+    }
+}
+
+// Null
+template <class Source>
+bool Parser<Source>::parse_14_Null() {
+    switch (la) {
+    case T_12: // null
+        // Null -> null
+        return match(T_12);
+    default:
+        return false;
+    }
+}
+
+}
+
+bool rdParse(const TokenList& tokens) {
+    Parser<VectorSource> parser{VectorSource{tokens.data(), tokens.data() + tokens.size()}};
+    parser.la = parser.src.next();
+    return parser.parse_0_Json() && parser.la == T_END;
+}
+
+bool rdParse(Generator<Token>& tokens) {
+    Parser<GeneratorSource> parser{GeneratorSource{tokens.begin(), tokens.end()}};
+    parser.la = parser.src.next();
+    return parser.parse_0_Json() && parser.la == T_END;
+}
+
+}
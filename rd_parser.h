@@ -0,0 +1,18 @@
+#ifndef JSONTOXML_RD_PARSER_H
+#define JSONTOXML_RD_PARSER_H
+
+#include "generator.h"
+#include "scanner.h"
+
+namespace jsontoxml {
+
+// Direct-coded recognizer for grammar.txt, generated into rd_parser.cpp by
+// `--gen-parser rd_parser.cpp`. It accepts exactly what LL1_parser accepts
+// for the same table, without interpreting the table at run time.
+extern const char* const rdGrammarSignature;
+bool rdParse(const TokenList& tokens);
+bool rdParse(Generator<Token>& tokens);
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+#include "result_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+CacheKey hashBytes(const char* data, size_t len, uint64_t seed) {
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    const unsigned char* p = (const unsigned char*)data;
+    size_t nblocks = len / 16;
+    uint64_t h1 = seed, h2 = seed;
+
+    for (size_t i = 0; i < nblocks; i++) {
+        uint64_t k1, k2;
+        memcpy(&k1, p + i * 16, 8);
+        memcpy(&k2, p + i * 16 + 8, 8);
+
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const unsigned char* tail = p + nblocks * 16;
+    uint64_t k1 = 0, k2 = 0;
+    switch (len & 15) {
+    case 15: k2 ^= (uint64_t)tail[14] << 48; [[fallthrough]];
+    case 14: k2 ^= (uint64_t)tail[13] << 40; [[fallthrough]];
+    case 13: k2 ^= (uint64_t)tail[12] << 32; [[fallthrough]];
+    case 12: k2 ^= (uint64_t)tail[11] << 24; [[fallthrough]];
+    case 11: k2 ^= (uint64_t)tail[10] << 16; [[fallthrough]];
+    case 10: k2 ^= (uint64_t)tail[9] << 8; [[fallthrough]];
+    case 9:  k2 ^= (uint64_t)tail[8];
+             k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+             [[fallthrough]];
+    case 8:  k1 ^= (uint64_t)tail[7] << 56; [[fallthrough]];
+    case 7:  k1 ^= (uint64_t)tail[6] << 48; [[fallthrough]];
+    case 6:  k1 ^= (uint64_t)tail[5] << 40; [[fallthrough]];
+    case 5:  k1 ^= (uint64_t)tail[4] << 32; [[fallthrough]];
+    case 4:  k1 ^= (uint64_t)tail[3] << 24; [[fallthrough]];
+    case 3:  k1 ^= (uint64_t)tail[2] << 16; [[fallthrough]];
+    case 2:  k1 ^= (uint64_t)tail[1] << 8; [[fallthrough]];
+    case 1:  k1 ^= (uint64_t)tail[0];
+             k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= len; h2 ^= len;
+    h1 += h2; h2 += h1;
+    h1 = fmix64(h1); h2 = fmix64(h2);
+    h1 += h2; h2 += h1;
+
+    CacheKey key;
+    key.lo = h1;
+    key.hi = h2;
+    return key;
+}
+
+string keyToHex(const CacheKey& key) {
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)key.hi, (unsigned long long)key.lo);
+    return buf;
+}
+
+ResultCache::ResultCache(const CacheLimits& limits) : limits(limits) {
+    size_t n = limits.shards ? limits.shards : 1;
+    shard_entries = limits.max_entries / n ? limits.max_entries / n : 1;
+    shard_bytes = limits.max_bytes / n;
+    for (size_t i = 0; i < n; i++) shards.emplace_back(new Shard);
+}
+
+bool ResultCache::lookup(const CacheKey& key, string& xml) {
+    Shard& shard = shard_for(key);
+    {
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            xml = it->second->second;
+            hit_count.fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    if (!limits.spill_dir.empty()) {
+        ifstream in(spill_path(key), ios::binary);
+        if (in) {
+            stringstream buffer;
+            buffer << in.rdbuf();
+            xml = buffer.str();
+            lock_guard<mutex> guard(shard.lock);
+            insert(shard, key, xml);
+            hit_count.fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    miss_count.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+void ResultCache::store(const CacheKey& key, const string& xml) {
+    Shard& shard = shard_for(key);
+    {
+        lock_guard<mutex> guard(shard.lock);
+        insert(shard, key, xml);
+    }
+    if (!limits.spill_dir.empty()) {
+        // Write then rename, so a concurrent reader or a crash never sees half
+        // a file. The temporary name is unique to this process and call, so
+        // two writers of the same key cannot rename each other's partial file.
+        static atomic<uint64_t> spills{0};
+        string path = spill_path(key);
+        string tmp = path + ".tmp." + to_string(getpid()) + "." + to_string(spills.fetch_add(1, memory_order_relaxed));
+        ofstream out(tmp, ios::binary);
+        out.write(xml.data(), xml.size());
+        out.close();
+        if (!out || rename(tmp.c_str(), path.c_str()) != 0) remove(tmp.c_str());
+    }
+}
+
+void ResultCache::insert(Shard& shard, const CacheKey& key, const string& xml) {
+    if (xml.size() > shard_bytes) return;
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.bytes -= it->second->second.size();
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    while (!shard.lru.empty() &&
+           (shard.lru.size() >= shard_entries || shard.bytes + xml.size() > shard_bytes)) {
+        shard.bytes -= shard.lru.back().second.size();
+        shard.index.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+    }
+    shard.lru.emplace_front(key, xml);
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += xml.size();
+}
+
+string ResultCache::spill_path(const CacheKey& key) const {
+    return limits.spill_dir + "/" + keyToHex(key) + ".xml";
+}
+
+size_t ResultCache::entries() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        lock_guard<mutex> guard(shard->lock);
+        total += shard->lru.size();
+    }
+    return total;
+}
+
+size_t ResultCache::bytes() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        lock_guard<mutex> guard(shard->lock);
+        total += shard->bytes;
+    }
+    return total;
+}
+
+}
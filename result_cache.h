@@ -0,0 +1,75 @@
+#ifndef JSONTOXML_RESULT_CACHE_H
+#define JSONTOXML_RESULT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace jsontoxml {
+
+// 128-bit content hash (MurmurHash3 x64_128).
+struct CacheKey {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+    bool operator==(const CacheKey& other) const { return lo == other.lo && hi == other.hi; }
+};
+CacheKey hashBytes(const char* data, size_t len, uint64_t seed = 0);
+std::string keyToHex(const CacheKey& key);
+
+struct CacheLimits {
+    size_t max_entries = 4096;
+    size_t max_bytes = 64 * 1024 * 1024;
+    // Both limits are split evenly between the shards.
+    size_t shards = 16;
+    // When set, every stored result is also written to <spill_dir>/<key>.xml,
+    // and a miss in memory is looked up there before converting again, so the
+    // cache survives restarts. Files are never removed by the cache.
+    std::string spill_dir;
+};
+
+// Bounded LRU cache of converted XML keyed by input hash. Each shard has its
+// own lock, so one cache can be shared by the Contexts of several threads.
+class ResultCache {
+public:
+    explicit ResultCache(const CacheLimits& limits = CacheLimits());
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    bool lookup(const CacheKey& key, std::string& xml);
+    void store(const CacheKey& key, const std::string& xml);
+
+    size_t hits() const { return hit_count.load(std::memory_order_relaxed); }
+    size_t misses() const { return miss_count.load(std::memory_order_relaxed); }
+    size_t entries() const;
+    size_t bytes() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const CacheKey& key) const { return key.lo; }
+    };
+    typedef std::list<std::pair<CacheKey, std::string>> Entries;
+    struct Shard {
+        mutable std::mutex lock;
+        Entries lru; // most recently used first
+        std::unordered_map<CacheKey, Entries::iterator, KeyHash> index;
+        size_t bytes = 0;
+    };
+
+    Shard& shard_for(const CacheKey& key) { return *shards[key.hi % shards.size()]; }
+    void insert(Shard& shard, const CacheKey& key, const std::string& xml);
+    std::string spill_path(const CacheKey& key) const;
+
+    CacheLimits limits;
+    size_t shard_entries, shard_bytes;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<size_t> hit_count{0}, miss_count{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "rule_table.h"
+
+#include <algorithm>
+#include <map>
+using namespace std;
+
+namespace jsontoxml {
+
+void RuleTable::build(size_t rows, size_t columns, const vector<RuleEntry>& entries, Layout layout) {
+    this->rows = rows;
+    this->columns = columns;
+    dense.clear();
+    base.clear();
+    defaults.clear();
+    slots.clear();
+    covered.clear();
+    if (layout == AUTO) {
+        size_t cells = rows * columns;
+        layout = cells * sizeof(int32_t) <= 256 * 1024 || entries.size() * 4 >= cells ? DENSE : COMB;
+    }
+    this->layout = layout;
+    if (layout == DENSE) {
+        dense.assign(rows * columns, NONE);
+        for (const RuleEntry& e : entries) dense[size_t(e.row) * columns + e.column] = e.rule;
+    } else {
+        pack(entries);
+    }
+}
+
+void RuleTable::pack(const vector<RuleEntry>& entries) {
+    vector<vector<RuleEntry>> byRow(rows);
+    for (const RuleEntry& e : entries) byRow[e.row].push_back(e);
+
+    // the most common rule of each row becomes its default, when it covers
+    // more than one lookahead
+    words_per_row = (columns + 63) / 64;
+    covered.assign(rows * words_per_row, 0);
+    defaults.assign(rows, NONE);
+    vector<vector<int>> packed(rows); // columns left for the shared vector
+    for (size_t r = 0; r < rows; r++) {
+        map<int, size_t> counts;
+        int best = NONE;
+        for (const RuleEntry& e : byRow[r]) {
+            if (++counts[e.rule] > (best == NONE ? 0 : counts[best])) best = e.rule;
+        }
+        if (best != NONE && counts[best] < 2) best = NONE;
+        defaults[r] = best;
+        for (const RuleEntry& e : byRow[r]) {
+            if (e.rule == best) {
+                size_t bit = r * words_per_row * 64 + e.column;
+                covered[bit / 64] |= uint64_t(1) << (bit % 64);
+            } else {
+                packed[r].push_back(e.column);
+            }
+        }
+        sort(packed[r].begin(), packed[r].end());
+    }
+
+    // First fit, fullest rows first: each row takes the lowest displacement
+    // at which all of its columns land on free slots.
+    vector<size_t> order(rows);
+    for (size_t r = 0; r < rows; r++) order[r] = r;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return packed[a].size() > packed[b].size(); });
+    base.assign(rows, 0);
+    vector<bool> used;
+    size_t top = 0;
+    for (size_t r : order) {
+        const vector<int>& cols = packed[r];
+        if (cols.empty()) continue;
+        size_t b = 0;
+        for (;; b++) {
+            bool fits = true;
+            for (int c : cols) {
+                if (b + c < used.size() && used[b + c]) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) break;
+        }
+        base[r] = int32_t(b);
+        for (int c : cols) {
+            if (b + c >= used.size()) used.resize(b + c + 1, false);
+            used[b + c] = true;
+        }
+        top = max(top, b);
+    }
+
+    // every row can index `columns` slots past its base
+    slots.assign(top + columns, Slot{NONE, NONE});
+    for (size_t r = 0; r < rows; r++) {
+        for (const RuleEntry& e : byRow[r]) {
+            if (e.rule == defaults[r]) continue;
+            slots[size_t(base[r]) + e.column] = Slot{int32_t(r), e.rule};
+        }
+    }
+}
+
+size_t RuleTable::bytes() const {
+    return (dense.size() + base.size() + defaults.size()) * sizeof(int32_t) + slots.size() * sizeof(Slot)
+         + covered.size() * sizeof(uint64_t);
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef JSONTOXML_RULE_TABLE_H
+#define JSONTOXML_RULE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jsontoxml {
+
+// One cell of an LL(1) table: the rule to expand `row` (a nonterminal id) by
+// when the lookahead is `column` (a terminal id).
+struct RuleEntry {
+    int row;
+    int column;
+    int rule;
+};
+
+// The LL(1) table indexed by symbol ids, in one of two layouts with O(1)
+// lookups:
+//   DENSE  rows x columns rule numbers, right for small grammars.
+//   COMB   row displacement: the rows are slid over each other until their
+//          entries land in free slots of one shared vector, and a slot
+//          belongs to a row when its check value is that row. Each row's most
+//          common rule is left out of the vector and kept as the row's
+//          default; a bitmap says which lookaheads it covers, so a missing
+//          entry is still an error rather than the default.
+// AUTO keeps the dense layout while it fits in 256 KB, about a core's L2,
+// or is at least a quarter full, and packs anything larger and sparser:
+// past the cache a dense lookup is a memory access, while a comb lookup
+// reads two or three small arrays that stay cached.
+class RuleTable {
+public:
+    enum Layout { AUTO, DENSE, COMB };
+    static constexpr int NONE = -1;
+
+    void build(size_t rows, size_t columns, const std::vector<RuleEntry>& entries, Layout layout = AUTO);
+
+    int lookup(int row, int column) const {
+        if (layout == DENSE) return dense[size_t(row) * columns + column];
+        const Slot& slot = slots[size_t(base[row]) + column];
+        if (slot.check == row) return slot.rule;
+        size_t bit = size_t(row) * words_per_row * 64 + column;
+        return (covered[bit / 64] >> (bit % 64)) & 1 ? defaults[row] : NONE;
+    }
+
+    Layout get_layout() const { return layout; }
+    // Bytes taken by the lookup arrays.
+    size_t bytes() const;
+
+private:
+    void pack(const std::vector<RuleEntry>& entries);
+
+    Layout layout = DENSE;
+    size_t rows = 0, columns = 0;
+    std::vector<int32_t> dense;
+    std::vector<int32_t> base, defaults;
+    // the owner row and rule side by side, so a hit reads one cache line
+    struct Slot {
+        int32_t check;
+        int32_t rule;
+    };
+    std::vector<Slot> slots;
+    std::vector<uint64_t> covered;
+    size_t words_per_row = 0;
+};
+
+}
+
+#endif
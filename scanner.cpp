@@ -0,0 +1,168 @@
+#include "scanner.h"
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+#include "line_index.h"
+#include "probes.h"
+#include "trace.h"
+using namespace std;
+
+namespace jsontoxml {
+
+// Adds an escape's characters to `out`; false for escapes it does not know.
+static bool escapeBytes(char c, bitset<256>& out) {
+    switch (c) {
+    case 'n': out.set('\n'); return true;
+    case 't': out.set('\t'); return true;
+    case 'r': out.set('\r'); return true;
+    case 'f': out.set('\f'); return true;
+    case 'v': out.set('\v'); return true;
+    case 'd': for (int ch = '0'; ch <= '9'; ch++) out.set(ch); return true;
+    case 's': for (char ch : string(" \t\n\r\f\v")) out.set((unsigned char)ch); return true;
+    default:
+        if (isalnum((unsigned char)c)) return false;
+        out.set((unsigned char)c);
+        return true;
+    }
+}
+
+// Bytes a match of `pattern` can start with, worked out for the simple
+// patterns token files use: a literal, an escape or a bracket class that is
+// not optional. Anything else is taken to start with any byte.
+static bitset<256> firstBytes(const string& pattern) {
+    bitset<256> any, first;
+    any.set();
+    if (pattern.empty() || pattern.find('|') != string::npos) return any;
+    size_t i = 1;
+    char c = pattern[0];
+    if (c == '\\') {
+        if (pattern.size() < 2 || !escapeBytes(pattern[1], first)) return any;
+        i = 2;
+    } else if (c == '[') {
+        bool negate = i < pattern.size() && pattern[i] == '^';
+        if (negate) i++;
+        for (bool leading = true;; leading = false) {
+            if (i >= pattern.size() || pattern[i] == '[') return any;
+            if (pattern[i] == ']' && !leading) break;
+            if (pattern[i] == '\\') {
+                if (i + 1 >= pattern.size() || !escapeBytes(pattern[i + 1], first)) return any;
+                i += 2;
+            } else if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+                unsigned char lo = pattern[i], hi = pattern[i + 2];
+                if (hi == '\\' || hi < lo) return any;
+                for (int ch = lo; ch <= hi; ch++) first.set(ch);
+                i += 3;
+            } else {
+                first.set((unsigned char)pattern[i]);
+                i++;
+            }
+        }
+        i++;
+        if (negate) first.flip();
+    } else if (string("^$.*+?()]{}").find(c) != string::npos) {
+        return any;
+    } else {
+        first.set((unsigned char)c);
+    }
+    // an optional first atom lets the match start with whatever comes next
+    if (i < pattern.size() && (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '{')) return any;
+    return first;
+}
+
+vector<TokenRule> loadTokenRules(const string& filename) {
+    vector<TokenRule> rules;
+    ifstream file(filename);
+    string name, pattern;
+
+    while (file >> name) {
+        file >> ws;
+        getline(file, pattern);
+        rules.push_back({name, regex(pattern), firstBytes(pattern)});
+    }
+
+    return rules;
+}
+
+bool scanInput(const char* in, size_t len, const vector<TokenRule>& rules,
+               TokenList& tokens, string& error, Diagnostics* diagnostics) {
+    return scanInput(in, len, rules, [&tokens](Token&& token) { tokens.push_back(move(token)); }, error,
+                     tokens.get_allocator().resource(), diagnostics);
+}
+
+bool scanInput(const char* in, size_t len, const vector<TokenRule>& rules,
+               const function<void(Token&&)>& emit, string& error, pmr::memory_resource* memory,
+               Diagnostics* diagnostics) {
+    string scanError;
+    size_t count = 0;
+    for (Token& token : scanTokens(in, len, rules, scanError, memory, diagnostics)) {
+        emit(move(token));
+        count++;
+    }
+    if (!scanError.empty()) {
+        error = scanError;
+        return false;
+    }
+
+    JTX_TRACE(TRACE_INFO, EV_SCAN_ACCEPTED, "", "", count);
+    return true;
+}
+
+Generator<Token> scanTokens(const char* in, size_t len, const vector<TokenRule>& rules, string& error,
+                            pmr::memory_resource* memory, Diagnostics* diagnostics) {
+    // Rules are matched straight against the buffer. Line numbers are only
+    // worked out, from the index, when there is an error to report.
+    LineIndex lines(in, len);
+    pmr::cmatch match(memory);
+    size_t i = 0;
+    size_t skipped = string::npos; // end of the last run of unknown characters
+
+    while (i < len) {
+        // match outside the co_yield so no temporaries live across a suspension
+        const TokenRule* matched = nullptr;
+        unsigned char next = in[i];
+        for (const auto& rule : rules) {
+            if (rule.first[next] && regex_search(in + i, in + len, match, rule.pattern, regex_constants::match_continuous)) {
+                matched = &rule;
+                break;
+            }
+        }
+        if (matched) {
+            size_t length = match.length();
+            if (matched->name != "WHITESPACE") {
+                Token token{pmr::string(matched->name, memory), pmr::string(in + i, length, memory), i};
+                i += length;
+                JTX_TRACE(TRACE_STEP, EV_TOKEN, token.name, token.value, token.offset);
+                co_yield move(token);
+            } else {
+                i += length;
+            }
+        } else {
+            if (skipped != i) {
+                int line, column;
+                lines.locate(i, line, column);
+                if (error.empty()) error = "ERROR: Unknown token at line " + to_string(line) + " near: " + in[i];
+                JTX_TRACE(TRACE_INFO, EV_SCAN_ERROR, string(1, in[i]), "", line);
+                JTX_PROBE1(scan_error, line);
+                if (!diagnostics || diagnostics->full()) co_return;
+                diagnostics->add({i, line, column, "Unknown character '" + string(1, in[i]) + "'", {}});
+            }
+            // resynchronize on the next character a rule matches
+            skipped = ++i;
+        }
+    }
+}
+
+void writeTokensToFile(const string& filename, const TokenList& tokens) {
+    ofstream output(filename);
+    if (!output) {
+        cerr << "Error: Cannot create output file " << filename << endl;
+        return;
+    }
+    for (const Token& token : tokens) {
+        output << token.name << " " << token.value << endl;
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef JSONTOXML_SCANNER_H
+#define JSONTOXML_SCANNER_H
+
+#include <bitset>
+#include <functional>
+#include <memory_resource>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "diagnostics.h"
+#include "generator.h"
+
+namespace jsontoxml {
+
+// Scanner
+struct TokenRule {
+    std::string name;
+    std::regex pattern;
+    // Bytes a match can start with; the scanner only tries the rule on those.
+    std::bitset<256> first;
+};
+struct Token {
+    std::pmr::string name;
+    std::pmr::string value;
+    // Byte offset into the input; LineIndex turns it into a line and column.
+    size_t offset;
+};
+typedef std::pmr::vector<Token> TokenList;
+
+std::vector<TokenRule> loadTokenRules(const std::string& filename);
+
+// Splits the input buffer into tokens. On an unknown character the scan stops,
+// `error` is filled in and false is returned. Token strings come from the
+// list's memory resource.
+// With `diagnostics`, the scan instead records each run of unknown characters,
+// skips it and carries on until the limit is reached; `error` still describes
+// the first one.
+bool scanInput(const char* in, size_t len, const std::vector<TokenRule>& rules,
+               TokenList& tokens, std::string& error, Diagnostics* diagnostics = nullptr);
+// Same scan, handing each token to `emit` as soon as it is matched.
+bool scanInput(const char* in, size_t len, const std::vector<TokenRule>& rules,
+               const std::function<void(Token&&)>& emit, std::string& error,
+               std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+               Diagnostics* diagnostics = nullptr);
+// Lazy form of the scan: a token is only matched when the consumer pulls it.
+// `in`, `rules`, `error`, `memory` and `diagnostics` must outlive the
+// generator. `error` is set and the sequence ends early on an unknown
+// character, unless `diagnostics` lets the scan recover.
+Generator<Token> scanTokens(const char* in, size_t len, const std::vector<TokenRule>& rules, std::string& error,
+                            std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+                            Diagnostics* diagnostics = nullptr);
+
+void writeTokensToFile(const std::string& filename, const TokenList& tokens);
+
+}
+
+#endif
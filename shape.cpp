@@ -0,0 +1,512 @@
+#include "shape.h"
+
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <sstream>
+
+#include "memory.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+namespace {
+// Just enough of a JSON tree to infer a shape or read a schema from. Strings
+// and keys keep their raw bytes, escapes included, as the converter sees them.
+struct Node {
+    Shape::Type type = Shape::NONE;
+    string text;
+    vector<pair<string, Node>> members;
+    vector<Node> items;
+
+    const Node* member(const string& key) const {
+        for (const auto& m : members)
+            if (m.first == key) return &m.second;
+        return nullptr;
+    }
+};
+
+class Reader {
+public:
+    Reader(const char* data, size_t len) : begin(data), p(data), end(data + len) {}
+
+    bool more() {
+        space();
+        return p < end;
+    }
+    bool value(Node& node, string& error, int depth = 0) {
+        space();
+        if (p == end) return fail("Unexpected end of input", error);
+        if (depth > 512) return fail("Nesting too deep", error);
+        char c = *p;
+        if (c == '{') {
+            node.type = Shape::OBJECT;
+            p++;
+            if (take('}')) return true;
+            do {
+                space();
+                if (p == end || *p != '"') return fail("Expected a key", error);
+                node.members.emplace_back();
+                node.members.back().first = raw_string();
+                if (!take(':')) return fail("Expected ':'", error);
+                if (!value(node.members.back().second, error, depth + 1)) return false;
+            } while (take(','));
+            return take('}') || fail("Expected ',' or '}'", error);
+        }
+        if (c == '[') {
+            node.type = Shape::ARRAY;
+            p++;
+            if (take(']')) return true;
+            do {
+                node.items.emplace_back();
+                if (!value(node.items.back(), error, depth + 1)) return false;
+            } while (take(','));
+            return take(']') || fail("Expected ',' or ']'", error);
+        }
+        if (c == '"') {
+            node.type = Shape::STRING;
+            node.text = raw_string();
+            return true;
+        }
+        if (isdigit((unsigned char)c) || c == '-' || c == '+') {
+            node.type = Shape::NUMBER;
+            while (p < end && (isalnum((unsigned char)*p) || *p == '.' || *p == '-' || *p == '+')) p++;
+            return true;
+        }
+        if (literal("true") || literal("false")) {
+            node.type = Shape::BOOLEAN;
+            return true;
+        }
+        if (literal("null")) {
+            node.type = Shape::NUL;
+            return true;
+        }
+        return fail("Unexpected character", error);
+    }
+
+private:
+    void space() {
+        while (p < end && isspace((unsigned char)*p)) p++;
+    }
+    bool take(char c) {
+        space();
+        if (p == end || *p != c) return false;
+        p++;
+        return true;
+    }
+    bool literal(string_view word) {
+        if (size_t(end - p) < word.size() || string_view(p, word.size()) != word) return false;
+        p += word.size();
+        return true;
+    }
+    string raw_string() {
+        const char* start = ++p;
+        while (p < end && *p != '"') p += *p == '\\' ? 2 : 1;
+        if (p > end) p = end;
+        string s(start, p - start);
+        if (p < end) p++;
+        return s;
+    }
+    bool fail(const string& what, string& error) {
+        error = "Error: " + what + " at byte " + to_string(p - begin);
+        return false;
+    }
+
+    const char* begin;
+    const char* p;
+    const char* end;
+};
+}
+
+// The generic converter ends a key at its first quote, so a key with an
+// escaped quote in it would be matched but tagged differently.
+static bool predictable(const string& key) {
+    return key.find('"') == string::npos;
+}
+
+static void merge(Shape& into, const Shape& other) {
+    if (other.type == Shape::NONE || into.type == Shape::ANY) return;
+    if (into.type == Shape::NONE) {
+        into = other;
+        return;
+    }
+    if (into.type != other.type || other.type == Shape::ANY) {
+        into = Shape();
+        into.type = Shape::ANY;
+        return;
+    }
+    if (into.type == Shape::OBJECT) {
+        for (const auto& m : other.members) {
+            bool found = false;
+            for (auto& mine : into.members) {
+                if (mine.first == m.first) {
+                    merge(mine.second, m.second);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) into.members.push_back(m);
+        }
+    } else if (into.type == Shape::ARRAY && !other.items.empty()) {
+        if (into.items.empty()) into.items = other.items;
+        else merge(into.items[0], other.items[0]);
+    }
+}
+
+static Shape shapeOf(const Node& node) {
+    Shape shape;
+    shape.type = node.type;
+    if (node.type == Shape::OBJECT) {
+        for (const auto& m : node.members) {
+            if (!predictable(m.first)) {
+                shape.type = Shape::ANY;
+                shape.members.clear();
+                return shape;
+            }
+            shape.members.emplace_back(m.first, shapeOf(m.second));
+        }
+    } else if (node.type == Shape::ARRAY) {
+        Shape items;
+        for (const Node& item : node.items) merge(items, shapeOf(item));
+        if (items.type != Shape::NONE) shape.items.push_back(items);
+    }
+    return shape;
+}
+
+bool inferShape(const char* data, size_t len, Shape& shape, string& error) {
+    Reader reader(data, len);
+    shape = Shape();
+    size_t documents = 0;
+    while (reader.more()) {
+        Node node;
+        if (!reader.value(node, error)) return false;
+        merge(shape, shapeOf(node));
+        documents++;
+    }
+    if (!documents) {
+        error = "Error: No sample documents";
+        return false;
+    }
+    return true;
+}
+
+static Shape::Type schemaType(const string& name) {
+    if (name == "object") return Shape::OBJECT;
+    if (name == "array") return Shape::ARRAY;
+    if (name == "string") return Shape::STRING;
+    if (name == "number" || name == "integer") return Shape::NUMBER;
+    if (name == "boolean") return Shape::BOOLEAN;
+    if (name == "null") return Shape::NUL;
+    return Shape::ANY;
+}
+
+static Shape schemaShape(const Node& schema) {
+    Shape shape;
+    shape.type = Shape::ANY;
+    if (schema.type != Shape::OBJECT) return shape;
+    const Node* type = schema.member("type");
+    const Node* properties = schema.member("properties");
+    const Node* items = schema.member("items");
+    if (type && type->type == Shape::STRING) shape.type = schemaType(type->text);
+    else if (type && type->type == Shape::ARRAY && type->items.size() == 1 && type->items[0].type == Shape::STRING)
+        shape.type = schemaType(type->items[0].text);
+    else if (!type && properties) shape.type = Shape::OBJECT;
+    else if (!type && items) shape.type = Shape::ARRAY;
+
+    if (shape.type == Shape::OBJECT) {
+        if (!properties || properties->type != Shape::OBJECT) {
+            shape.type = Shape::ANY;
+            return shape;
+        }
+        for (const auto& m : properties->members) {
+            if (!predictable(m.first)) {
+                shape.type = Shape::ANY;
+                shape.members.clear();
+                return shape;
+            }
+            shape.members.emplace_back(m.first, schemaShape(m.second));
+        }
+    } else if (shape.type == Shape::ARRAY && items && items->type == Shape::OBJECT) {
+        shape.items.push_back(schemaShape(*items));
+    }
+    return shape;
+}
+
+bool readSchema(const char* data, size_t len, Shape& shape, string& error) {
+    Reader reader(data, len);
+    Node schema;
+    if (!reader.value(schema, error)) return false;
+    if (schema.type != Shape::OBJECT) {
+        error = "Error: A schema must be an object";
+        return false;
+    }
+    shape = schemaShape(schema);
+    return true;
+}
+
+// Other bytes outside printable ASCII become three-digit octal escapes,
+// which cannot run into the byte after them.
+static string cString(string_view s) {
+    string out = "\"";
+    for (char c : s) {
+        unsigned char u = (unsigned char)c;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (u < 0x20 || u >= 0x7f) {
+            char buf[5];
+            snprintf(buf, sizeof(buf), "\\%03o", u);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static string describe(const Shape& shape) {
+    switch (shape.type) {
+    case Shape::STRING: return "string";
+    case Shape::NUMBER: return "number";
+    case Shape::BOOLEAN: return "boolean";
+    case Shape::NUL: return "null";
+    case Shape::ARRAY: return "[" + (shape.items.empty() ? string("any") : describe(shape.items[0])) + "]";
+    case Shape::OBJECT: {
+        string s = "{";
+        for (size_t i = 0; i < shape.members.size(); i++) {
+            if (i) s += ", ";
+            for (char c : shape.members[i].first) s += isprint((unsigned char)c) ? c : '?';
+            s += ": " + describe(shape.members[i].second);
+        }
+        return s + "}";
+    }
+    default: return "any";
+    }
+}
+
+namespace {
+// Emits one function per position of the shape, children before their
+// parents, each knowing its level and tag.
+class ConverterWriter {
+public:
+    string function(const Shape& shape, int level, const string& tag) {
+        string name = "value_" + to_string(count++);
+        string ind(level * 2, ' ');
+        string fallback = "c.value(xml, " + to_string(level) + ", " + cString(tag) + ")";
+        stringstream body;
+        switch (shape.type) {
+        case Shape::STRING:
+            body << "    if (!c.take('\"')) return " << fallback << ";\n"
+                 << "    " << append(ind + "<" + tag + ">") << "\n"
+                 << "    c.copy_string(xml);\n"
+                 << "    " << append("</" + tag + ">\n") << "\n";
+            break;
+        case Shape::NUMBER:
+            body << "    char ch = c.peek();\n"
+                 << "    if (!(isdigit((unsigned char)ch) || ch == '-' || ch == '+')) return " << fallback << ";\n"
+                 << "    " << append(ind + "<" + tag + ">") << "\n"
+                 << "    c.copy_number(xml);\n"
+                 << "    " << append("</" + tag + ">\n") << "\n";
+            break;
+        case Shape::BOOLEAN:
+            body << "    char ch = c.peek();\n"
+                 << "    if (ch == 't') {\n"
+                 << "        c.skip(4);\n"
+                 << "        " << append(ind + "<" + tag + ">true</" + tag + ">\n") << "\n"
+                 << "    } else if (ch == 'f') {\n"
+                 << "        c.skip(5);\n"
+                 << "        " << append(ind + "<" + tag + ">false</" + tag + ">\n") << "\n"
+                 << "    } else {\n"
+                 << "        " << fallback << ";\n"
+                 << "    }\n";
+            break;
+        case Shape::NUL:
+            body << "    if (c.peek() != 'n') return " << fallback << ";\n"
+                 << "    c.skip(4);\n"
+                 << "    " << append(ind + "<" + tag + "/>\n") << "\n";
+            break;
+        case Shape::OBJECT: {
+            vector<string> members;
+            for (const auto& m : shape.members) members.push_back(function(m.second, level + 1, m.first));
+            string rest = "c.members(xml, " + to_string(level) + ", " + cString(tag) + ")";
+            body << "    if (!c.take('{')) return " << fallback << ";\n"
+                 << "    " << append(ind + "<" + tag + ">\n") << "\n";
+            for (size_t i = 0; i < members.size(); i++) {
+                const string& key = shape.members[i].first;
+                body << "    if (" << (i ? "!c.take(',') || " : "") << "!c.take_key(" << cString("\"" + key + "\"")
+                     << ", " << key.size() + 2 << ")) return " << rest << ";\n"
+                     << "    " << members[i] << "(c, xml);\n";
+            }
+            body << "    if (!c.take('}')) return " << rest << ";\n"
+                 << "    " << append(ind + "</" + tag + ">\n") << "\n"
+                 << "    xml.element_done();\n";
+            break;
+        }
+        case Shape::ARRAY: {
+            Shape any;
+            any.type = Shape::ANY;
+            string item = function(shape.items.empty() ? any : shape.items[0], level + 1, "item");
+            body << "    if (!c.take('[')) return " << fallback << ";\n"
+                 << "    for (;;) {\n"
+                 << "        char ch = c.peek();\n"
+                 << "        if (!ch || ch == ']') {\n"
+                 << "            c.skip(1);\n"
+                 << "            break;\n"
+                 << "        }\n"
+                 << "        " << append(ind + "<" + tag + ">\n") << "\n"
+                 << "        " << item << "(c, xml);\n"
+                 << "        " << append(ind + "</" + tag + ">\n") << "\n"
+                 << "        xml.element_done();\n"
+                 << "        ch = c.peek();\n"
+                 << "        if (ch == ',' || ch == ']') c.skip(1);\n"
+                 << "        if (!ch || ch == ']') break;\n"
+                 << "    }\n";
+            break;
+        }
+        default:
+            body << "    " << fallback << ";\n";
+        }
+        functions << "\n// " << (level ? "" : "root ") << describe(shape).substr(0, 100) << "\n"
+                  << "void " << name << "(ShapeCursor& c, XmlOutput& xml) {\n" << body.str() << "}\n";
+        return name;
+    }
+
+    stringstream functions;
+
+private:
+    static string append(const string& bytes) {
+        return "xml.data.append(" + cString(bytes) + ", " + to_string(bytes.size()) + ");";
+    }
+
+    size_t count = 0;
+};
+}
+
+bool generateConverter(const Shape& shape, const string& name, ostream& out, string& error) {
+    if (name.empty()) {
+        error = "Error: A converter needs a name";
+        return false;
+    }
+    ConverterWriter writer;
+    string root = writer.function(shape, 0, "root");
+    char open = shape.type == Shape::OBJECT ? '{' : shape.type == Shape::ARRAY ? '[' : 0;
+
+    out << "// Generated by --gen-converter for documents shaped like\n"
+           "//   " << describe(shape).substr(0, 400) << "\n"
+           "// Do not edit; regenerate it when the feed's shape changes.\n"
+           "#include \"shape.h\"\n\n"
+           "#include <cctype>\n"
+           "using namespace std;\n\n"
+           "namespace jsontoxml {\n\n"
+           "namespace {\n"
+        << writer.functions.str()
+        << "\nvoid convert(const char* in, size_t len, XmlOutput& xml) {\n"
+           "    ShapeCursor c{in, in + len};\n";
+    if (open) out << "    if (c.peek() == '" << open << "') " << root << "(c, xml);\n";
+    out << "    c.finish(xml);\n"
+           "}\n\n"
+           "const ShapeRegistration registration({" << cString(name) << ", convert});\n"
+           "}\n\n"
+           "}\n";
+    return true;
+}
+
+bool generateConverterFile(const string& input_file, bool schema, const string& output_file, string& error) {
+    ifstream in(input_file, ios::binary);
+    if (!in) {
+        error = "Error: Cannot open " + input_file;
+        return false;
+    }
+    stringstream buffer;
+    buffer << in.rdbuf();
+    string text = buffer.str();
+    Shape shape;
+    string problem;
+    if (!(schema ? readSchema(text.data(), text.size(), shape, problem)
+                 : inferShape(text.data(), text.size(), shape, problem))) {
+        error = problem + " in " + input_file;
+        return false;
+    }
+
+    string name;
+    for (char c : filesystem::path(output_file).stem().string()) name += isalnum((unsigned char)c) ? c : '_';
+    stringstream code;
+    if (!generateConverter(shape, name, code, error)) return false;
+    ofstream out(output_file);
+    out << code.str();
+    if (!out) {
+        error = "Error: Cannot write " + output_file;
+        return false;
+    }
+    return true;
+}
+
+static list<ShapeConverter>& registry() {
+    static list<ShapeConverter> converters;
+    return converters;
+}
+
+void registerShapeConverter(const ShapeConverter& converter) {
+    for (ShapeConverter& known : registry()) {
+        if (string_view(known.name) == converter.name) {
+            known = converter;
+            return;
+        }
+    }
+    registry().push_back(converter);
+}
+
+const ShapeConverter* findShapeConverter(string_view name) {
+    for (const ShapeConverter& known : registry())
+        if (name == known.name) return &known;
+    return nullptr;
+}
+
+vector<string> shapeConverterNames() {
+    vector<string> names;
+    for (const ShapeConverter& known : registry()) names.push_back(known.name);
+    return names;
+}
+
+bool loadShapePlugin(const string& path, string& error) {
+#if defined(__unix__) || defined(__APPLE__)
+    // a bare file name would be looked up on the library path instead
+    string file = path.find('/') == string::npos ? "./" + path : path;
+    if (!dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL)) {
+        error = "Error: Cannot load plug-in '" + path + "': " + dlerror();
+        return false;
+    }
+    return true;
+#else
+    error = "Error: Plug-ins are not supported on this platform";
+    return false;
+#endif
+}
+
+void ShapeCursor::value(XmlOutput& xml, int level, string_view tag) {
+    InputBuffer input(at, end - at);
+    istream ss(&input);
+    parseValue(ss, xml, level, tag);
+    at += inputOffset(ss);
+}
+
+void ShapeCursor::members(XmlOutput& xml, int level, string_view tag) {
+    InputBuffer input(at, end - at);
+    istream ss(&input);
+    parseMembers(ss, xml, level, tag);
+    at += inputOffset(ss);
+}
+
+void ShapeCursor::finish(XmlOutput& xml) {
+    InputBuffer input(at, end - at);
+    istream ss(&input);
+    parseJSONtoXML(ss, xml, 0, "root");
+    at = end;
+}
+
+}
@@ -0,0 +1,124 @@
+#ifndef JSONTOXML_SHAPE_H
+#define JSONTOXML_SHAPE_H
+
+#include <cctype>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "converter.h"
+
+namespace jsontoxml {
+
+// The expected structure of a feed's documents: one type per position, and
+// for objects the members in the order they usually come in. ANY positions
+// are left to the generic converter.
+struct Shape {
+    enum Type { NONE, ANY, STRING, NUMBER, BOOLEAN, NUL, OBJECT, ARRAY };
+    Type type = NONE;
+    std::vector<std::pair<std::string, Shape>> members; // raw key bytes, as written between the quotes
+    std::vector<Shape> items;                           // the element shape of an ARRAY, when known
+};
+
+// Infers the shape of every document in `data` (one after another, as in
+// JSON Lines) and merges them: members keep the order they were first seen
+// in and positions whose type differs between documents become ANY.
+bool inferShape(const char* data, size_t len, Shape& shape, std::string& error);
+// Reads the shape from a JSON Schema. Only "type", "properties" (in the
+// order written) and "items" are used; anything the converter cannot
+// predict, such as a union of types, becomes ANY.
+bool readSchema(const char* data, size_t len, Shape& shape, std::string& error);
+
+// Writes a C++ source file with a converter specialized for `shape`,
+// registered under `name`. It produces the same XML as parseJSONtoXML: each
+// predicted key is matched with one memcmp and its tags are written as
+// prebuilt literals, and the first value or member that does not fit the
+// shape is handed to parseValue or parseMembers.
+bool generateConverter(const Shape& shape, const std::string& name, std::ostream& out, std::string& error);
+// Reads samples (or a schema) from input_file and writes the converter to
+// output_file, named after its file name without the extension.
+bool generateConverterFile(const std::string& input_file, bool schema, const std::string& output_file,
+                           std::string& error);
+
+// A generated converter. It expects a document that has been validated.
+struct ShapeConverter {
+    const char* name;
+    void (*convert)(const char* in, size_t len, XmlOutput& xml);
+};
+
+// Generated converters register themselves when their translation unit is
+// linked in or their shared object is loaded. A later registration replaces
+// an earlier one of the same name.
+void registerShapeConverter(const ShapeConverter& converter);
+const ShapeConverter* findShapeConverter(std::string_view name);
+std::vector<std::string> shapeConverterNames();
+// Loads a generated converter built as a shared object, e.g.
+//   g++ -std=c++20 -O2 -shared -fPIC -I<repo> feed_shape.cpp -o feed_shape.so
+// The main binary must be linked with -rdynamic so the plug-in can reach
+// the generic converter.
+bool loadShapePlugin(const std::string& path, std::string& error);
+
+struct ShapeRegistration {
+    explicit ShapeRegistration(const ShapeConverter& converter) { registerShapeConverter(converter); }
+};
+
+// Read position of a generated converter. The inline members are its fast
+// path; the others hand the rest of a value, object or document to the
+// generic converter and continue after it.
+struct ShapeCursor {
+    const char* at;
+    const char* end;
+
+    // isspace(), the set `istream >> ch` skips
+    void skip_space() {
+        while (at < end && isspace((unsigned char)*at)) at++;
+    }
+    // The next non-space byte, or 0 at the end.
+    char peek() {
+        skip_space();
+        return at < end ? *at : 0;
+    }
+    bool take(char c) {
+        if (peek() != c) return false;
+        at++;
+        return true;
+    }
+    // Matches a member's `"key"` (quotes included in `quoted`) and its colon.
+    bool take_key(const char* quoted, size_t len) {
+        skip_space();
+        if (size_t(end - at) < len || memcmp(at, quoted, len) != 0) return false;
+        const char* p = at + len;
+        while (p < end && isspace((unsigned char)*p)) p++;
+        if (p == end || *p != ':') return false;
+        at = p + 1;
+        return true;
+    }
+    // The bytes of a string after its opening quote, up to the closing one.
+    void copy_string(XmlOutput& xml) {
+        const char* close = (const char*)memchr(at, '"', end - at);
+        if (!close) close = end;
+        xml.verbatim(at, close - at);
+        at = close == end ? end : close + 1;
+    }
+    // A number whose first byte has been checked, as parseValue reads it.
+    void copy_number(XmlOutput& xml) {
+        const char* p = at + 1;
+        while (p < end && (isdigit((unsigned char)*p) || *p == '.')) p++;
+        xml.data.append(at, p - at);
+        at = p;
+    }
+    void skip(size_t n) {
+        at = size_t(end - at) < n ? end : at + n;
+    }
+
+    void value(XmlOutput& xml, int level, std::string_view tag);
+    void members(XmlOutput& xml, int level, std::string_view tag);
+    void finish(XmlOutput& xml);
+};
+
+}
+
+#endif
@@ -0,0 +1,187 @@
+#include "shard.h"
+
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "memory.h"
+using namespace std;
+
+namespace jsontoxml {
+
+namespace {
+struct Span {
+    const char* begin;
+    const char* end;
+};
+
+static const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// The '[' of the first array `select` matches fully inside the value at `p`.
+static const char* findArray(const char* p, const char* end, const PathSelector& select,
+                             const PathSelector::State& state) {
+    p = skipSpace(p, end);
+    if (p == end || (*p != '{' && *p != '[')) return nullptr;
+    bool object = *p == '{';
+    PathSelector::State next;
+    size_t index = 0;
+    for (p++;;) {
+        p = skipSpace(p, end);
+        if (p == end || *p == '}' || *p == ']') return nullptr;
+        PathSelector::Match match;
+        if (object) {
+            const char* close = findStringEnd(p + 1, end);
+            match = select.key(state, string_view(p + 1, close - p - 1), next);
+            p = skipSpace(close + (close < end), end);
+            if (p < end && *p == ':') p++;
+            p = skipSpace(p, end);
+        } else {
+            match = select.index(state, index++, next);
+        }
+        if (match == PathSelector::FULL && p < end && *p == '[') return p;
+        if (match == PathSelector::PARTIAL) {
+            if (const char* found = findArray(p, end, select, next)) return found;
+        }
+        p = skipSpace(skipRawValue(p, end), end);
+        if (p < end && *p == ',') p++;
+    }
+}
+
+static string quoted(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + '"';
+}
+
+static string shardName(const string& prefix, size_t i) {
+    char number[32];
+    snprintf(number, sizeof(number), "-%05zu.xml", i);
+    return prefix + number;
+}
+
+static string baseName(const string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+}
+
+bool writeShards(const char* in, size_t len, const string& source, const ShardOptions& options,
+                 vector<ShardInfo>& shards, string& error) {
+    shards.clear();
+    const char* end = in + len;
+    const char* array = nullptr;
+    if (options.select) {
+        PathSelector::State state;
+        PathSelector::Match match = options.select->start(state);
+        const char* root = skipSpace(in, end);
+        if (match == PathSelector::FULL && root < end && *root == '[') array = root;
+        else if (match == PathSelector::PARTIAL) array = findArray(root, end, *options.select, state);
+    } else {
+        array = skipSpace(in, end);
+        if (array == end || *array != '[') array = nullptr;
+    }
+    if (!array) {
+        error = options.select ? "Error: '" + options.select->text() + "' selects no array to shard"
+                               : "Error: The input is not an array to shard";
+        return false;
+    }
+
+    vector<Span> records;
+    for (const char* p = skipSpace(array + 1, end); p < end && *p != ']';) {
+        const char* next = skipRawValue(p, end);
+        records.push_back({p, next});
+        p = skipSpace(next, end);
+        if (p < end && *p == ',') p = skipSpace(p + 1, end);
+    }
+
+    // plan the shards over the record list
+    if (options.shards || options.records) {
+        size_t per = options.shards ? max<size_t>(1, (records.size() + options.shards - 1) / options.shards)
+                                    : options.records;
+        for (size_t first = 0; first < records.size(); first += per) {
+            shards.push_back({shardName(options.prefix, shards.size()), first, min(per, records.size() - first), 0});
+        }
+    } else {
+        uint64_t filled = 0;
+        for (size_t i = 0; i < records.size(); i++) {
+            uint64_t size = records[i].end - records[i].begin;
+            if (shards.empty() || (filled && filled + size > options.bytes)) {
+                shards.push_back({shardName(options.prefix, shards.size()), i, 0, 0});
+                filled = 0;
+            }
+            shards.back().records++;
+            filled += size;
+        }
+    }
+
+    // Each writer takes the next unwritten shard and converts its records
+    // into 64 KB blocks that go to the file as they fill.
+    atomic<size_t> next{0};
+    mutex lock;
+    string failure;
+    auto work = [&] {
+        for (size_t s; (s = next++) < shards.size();) {
+            ShardInfo& shard = shards[s];
+            ofstream out(shard.file, ios::binary);
+            XmlOutput xml;
+            xml.block_size = 64 * 1024;
+            xml.flush = [&out](pmr::string& data) {
+                out.write(data.data(), data.size());
+                data.clear();
+            };
+            xml += "<root>\n";
+            for (size_t r = shard.first; r < shard.first + shard.records; r++) {
+                InputBuffer input(records[r].begin, records[r].end - records[r].begin);
+                istream record(&input);
+                parseValue(record, xml, 1, "item");
+                xml.element_done();
+            }
+            xml += "</root>\n";
+            xml.finish();
+            shard.bytes = xml.offset();
+            out.close();
+            if (!out) {
+                lock_guard<mutex> guard(lock);
+                if (failure.empty()) failure = "Error: Cannot write '" + shard.file + "'";
+            }
+        }
+    };
+    size_t count = options.writers ? options.writers : max(1u, thread::hardware_concurrency());
+    vector<thread> writers;
+    for (size_t i = 1; i < min(count, shards.size()); i++) writers.emplace_back(work);
+    work();
+    for (thread& t : writers) t.join();
+    if (!failure.empty()) {
+        error = failure;
+        return false;
+    }
+
+    string manifest = options.prefix + ".manifest.json";
+    ofstream out(manifest, ios::binary);
+    out << "{\n  \"source\": " << quoted(source) << ",\n  \"path\": "
+        << quoted(options.select ? options.select->text() : "$") << ",\n  \"records\": " << records.size()
+        << ",\n  \"shards\": [";
+    for (size_t s = 0; s < shards.size(); s++) {
+        const ShardInfo& shard = shards[s];
+        out << (s ? ",\n" : "\n") << "    {\"file\": " << quoted(baseName(shard.file)) << ", \"first\": " << shard.first
+            << ", \"records\": " << shard.records << ", \"bytes\": " << shard.bytes << "}";
+    }
+    out << (shards.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    out.close();
+    if (!out) {
+        error = "Error: Cannot write '" + manifest + "'";
+        return false;
+    }
+    return true;
+}
+
+}
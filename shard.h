@@ -0,0 +1,57 @@
+#ifndef JSONTOXML_SHARD_H
+#define JSONTOXML_SHARD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "projection.h"
+
+namespace jsontoxml {
+
+// How the records of an array are split. Set one of shards, records and
+// bytes; if more are set, shards wins over records and records over bytes.
+struct ShardOptions {
+    // Shards are written to <prefix>-00000.xml, <prefix>-00001.xml, ... and
+    // listed in <prefix>.manifest.json.
+    std::string prefix = "xml";
+    // The array whose elements are the records; the top-level value when
+    // null. The first array the selector matches fully is used.
+    const PathSelector* select = nullptr;
+    size_t shards = 0;  // this many shards of (nearly) equal record counts
+    size_t records = 0; // at most this many records per shard
+    uint64_t bytes = 0; // about this many bytes of the records' JSON per shard
+    size_t writers = 0; // threads converting and writing shards; 0 picks one per core
+};
+
+struct ShardInfo {
+    std::string file;
+    size_t first = 0;   // index of its first record in the array
+    size_t records = 0;
+    uint64_t bytes = 0; // size of the file
+};
+
+// Splits the records of an array in a validated document into shards, each
+// a well-formed document of its own:
+//
+//   <root>
+//     <item>...</item>
+//   </root>
+//
+// where the <item>s are what parseValue writes for each record in turn with
+// the tag "item": one element for an object or scalar record, but one
+// sibling <item> per element, wrapping that element, for an array record and
+// none for an empty one. A shard therefore holds its records' content, not
+// one <item> per record.
+//
+// The shards are converted and written concurrently by `writers` threads
+// straight from the input; the manifest, listing `source`, the path, the
+// record count and every shard's file, record range and size, is written
+// once they are all done. False, with `error` set, when no array is found or
+// a file cannot be written.
+bool writeShards(const char* in, size_t len, const std::string& source, const ShardOptions& options,
+                 std::vector<ShardInfo>& shards, std::string& error);
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef JSONTOXML_SPSC_RING_H
+#define JSONTOXML_SPSC_RING_H
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace jsontoxml {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. The capacity is rounded up to a power of two. Blocking push/pop spin
+// with yield, which suits pipeline stages that are expected to stay busy.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    bool try_push(T&& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) return false;
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T&& value) {
+        while (!try_push(std::move(value))) std::this_thread::yield();
+    }
+
+    // Returns false once the producer has closed the ring and it is drained.
+    bool pop(T& value) {
+        while (!try_pop(value)) {
+            if (closed.load(std::memory_order_acquire)) return try_pop(value);
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<bool> closed{false};
+};
+
+}
+
+#endif
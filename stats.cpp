@@ -0,0 +1,86 @@
+#include "stats.h"
+
+#include "probes.h"
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+namespace jsontoxml {
+
+atomic<bool> countAllocations{false};
+atomic<size_t> allocationCount{0}, allocatedBytes{0};
+
+long peakRssKb() {
+#ifdef __unix__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+StageStats& Stats::stage(const string& name) {
+    for (StageStats& s : stages) {
+        if (s.name == name) return s;
+    }
+    stages.push_back(StageStats());
+    stages.back().name = name;
+    return stages.back();
+}
+
+void Stats::print(ostream& out) const {
+    out << "stage           wall ms    cpu ms   bytes in  bytes out    allocs  alloc bytes  peak rss kb" << endl;
+    for (const StageStats& s : stages) {
+        out.width(12);
+        out << left << s.name << right;
+        out.width(12); out << s.wall_ms;
+        out.width(10); out << s.cpu_ms;
+        out.width(11); out << s.bytes_in;
+        out.width(11); out << s.bytes_out;
+        out.width(10); out << s.allocations;
+        out.width(13); out << s.allocated_bytes;
+        out.width(13); out << s.peak_rss_kb << endl;
+    }
+    out << "tokens: " << tokens << ", peak parse stack depth: " << peak_stack_depth << endl;
+}
+
+void Stats::print_json(ostream& out) const {
+    out << "{\"tokens\":" << tokens << ",\"peak_stack_depth\":" << peak_stack_depth << ",\"stages\":[";
+    for (size_t i = 0; i < stages.size(); i++) {
+        const StageStats& s = stages[i];
+        out << (i ? "," : "") << "{\"name\":\"" << s.name << "\",\"wall_ms\":" << s.wall_ms
+            << ",\"cpu_ms\":" << s.cpu_ms << ",\"bytes_in\":" << s.bytes_in
+            << ",\"bytes_out\":" << s.bytes_out << ",\"allocations\":" << s.allocations
+            << ",\"allocated_bytes\":" << s.allocated_bytes << ",\"peak_rss_kb\":" << s.peak_rss_kb << "}";
+    }
+    out << "]}" << endl;
+}
+
+StageTimer::StageTimer(Stats* stats, const char* name, size_t bytes_in)
+    : stats(stats), name(name), bytes_in(bytes_in) {
+    JTX_PROBE2(stage_start, name, bytes_in);
+    wall = chrono::steady_clock::now();
+    if (!stats) return;
+    allocations = allocationCount.load(memory_order_relaxed);
+    allocated = allocatedBytes.load(memory_order_relaxed);
+    cpu = clock();
+}
+
+StageTimer::~StageTimer() {
+    auto elapsed = chrono::steady_clock::now() - wall;
+    JTX_PROBE4(stage_end, name, bytes_in, bytes_out, chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+    if (!stats) return;
+    double wall_ms = chrono::duration<double, milli>(elapsed).count();
+    double cpu_ms = (clock() - cpu) * 1000.0 / CLOCKS_PER_SEC;
+    StageStats& s = stats->stage(name);
+    s.wall_ms += wall_ms;
+    s.cpu_ms += cpu_ms;
+    s.bytes_in += bytes_in;
+    s.bytes_out += bytes_out;
+    s.allocations += allocationCount.load(memory_order_relaxed) - allocations;
+    s.allocated_bytes += allocatedBytes.load(memory_order_relaxed) - allocated;
+    s.peak_rss_kb = peakRssKb();
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef JSONTOXML_STATS_H
+#define JSONTOXML_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace jsontoxml {
+
+// Heap counters. The library never replaces operator new itself; a binary that
+// wants allocation figures (the CLI does) bumps these from its own operator new
+// while countAllocations is set.
+extern std::atomic<bool> countAllocations;
+extern std::atomic<size_t> allocationCount, allocatedBytes;
+
+struct StageStats {
+    std::string name;
+    double wall_ms = 0;
+    double cpu_ms = 0;
+    size_t bytes_in = 0;
+    size_t bytes_out = 0;
+    size_t allocations = 0;
+    size_t allocated_bytes = 0;
+    long peak_rss_kb = 0;
+};
+
+// Per-stage figures for one run. Collection is opt-in: every hook takes a
+// Stats pointer and does nothing when it is null.
+class Stats {
+public:
+    std::vector<StageStats> stages;
+    size_t tokens = 0;
+    size_t peak_stack_depth = 0;
+
+    StageStats& stage(const std::string& name);
+    void print(std::ostream& out) const;
+    void print_json(std::ostream& out) const;
+};
+
+// Times the enclosing scope into stats->stage(name). Repeated scopes with the
+// same name accumulate. The stage_start/stage_end probes fire even without
+// a Stats object.
+class StageTimer {
+public:
+    StageTimer(Stats* stats, const char* name, size_t bytes_in = 0);
+    ~StageTimer();
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+    size_t bytes_out = 0;
+
+private:
+    Stats* stats;
+    const char* name;
+    size_t bytes_in;
+    std::chrono::steady_clock::time_point wall;
+    std::clock_t cpu;
+    size_t allocations, allocated;
+};
+
+long peakRssKb();
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+namespace jsontoxml {
+
+int traceLevel = TRACE_OFF;
+
+namespace {
+
+const size_t TRACE_CAPACITY = 1 << 16;
+const char TRACE_MAGIC[8] = {'J', 'T', 'X', 'T', 'R', 'A', 'C', '1'};
+
+atomic<uint64_t> next{0};
+
+// Allocated by the first event, so untraced runs (and builds with tracing
+// compiled out, which never get here) do not carry the 4 MB ring.
+vector<TraceRecord>& ring() {
+    static vector<TraceRecord> records(TRACE_CAPACITY);
+    return records;
+}
+
+void copyField(char* dest, string_view src) {
+    size_t n = min(src.size(), sizeof(TraceRecord::a) - 1);
+    memcpy(dest, src.data(), n);
+    dest[n] = '\0';
+}
+
+}
+
+void traceEvent(int level, TraceEvent event, string_view a, string_view b, uint32_t number) {
+    TraceRecord& r = ring()[next.fetch_add(1, memory_order_relaxed) & (TRACE_CAPACITY - 1)];
+    r.time_ns = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+    r.event = event;
+    r.level = level;
+    r.reserved = 0;
+    r.number = number;
+    copyField(r.a, a);
+    copyField(r.b, b);
+}
+
+size_t dumpTrace(const string& filename) {
+    ofstream out(filename, ios::binary);
+    if (!out) {
+        cerr << "Error: Cannot create trace file " << filename << endl;
+        return 0;
+    }
+    uint64_t end = next.load();
+    uint64_t begin = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    for (uint64_t i = begin; i < end; i++) {
+        out.write(reinterpret_cast<const char*>(&ring()[i & (TRACE_CAPACITY - 1)]), sizeof(TraceRecord));
+    }
+    return end - begin;
+}
+
+bool decodeTrace(const string& filename, ostream& out) {
+    ifstream in(filename, ios::binary);
+    char magic[sizeof(TRACE_MAGIC)];
+    if (!in || !in.read(magic, sizeof(magic)) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) {
+        cerr << "Error: " << filename << " is not a trace file" << endl;
+        return false;
+    }
+    TraceRecord r;
+    uint64_t start = 0;
+    while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+        if (!start) start = r.time_ns;
+        out << "[" << (r.time_ns - start) / 1000.0 << " us] ";
+        switch (r.event) {
+            case EV_SCAN_ACCEPTED: out << "ACCEPTED (" << r.number << " tokens)"; break;
+            case EV_SCAN_ERROR: out << "ERROR: Unknown token at line " << r.number << " near: " << r.a; break;
+            case EV_TOKEN: out << "Token: " << r.a << " " << r.b << " (offset " << r.number << ")"; break;
+            case EV_TABLE_ENTRY: out << "Building entry for: " << r.a << " -> " << r.b; break;
+            case EV_TABLE_BUILT: out << "parsing table is done! (" << r.number << " entries)"; break;
+            case EV_START_SYMBOL: out << "Start symbol: " << r.a; break;
+            case EV_PARSE_STEP: out << "Top of stack: " << r.a << ", Current token: " << r.b << " (depth " << r.number << ")"; break;
+            case EV_RULE_MATCH: out << "Matched Rule: " << r.b << " for " << r.a; break;
+            case EV_RULE_MISSING: out << "No rule found for: " << r.a << "," << r.b; break;
+            case EV_PARSE_ACCEPTED: out << "accepted!!"; break;
+            case EV_PARSE_REJECTED: out << "not accepted!! at " << r.a << ", token " << r.b; break;
+            default: out << "event " << r.event << " " << r.a << " " << r.b << " " << r.number; break;
+        }
+        out << endl;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef JSONTOXML_TRACE_H
+#define JSONTOXML_TRACE_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// Compile-time ceiling for tracing. 0 compiles every JTX_TRACE away; the
+// Debug build sets it to TRACE_STEP.
+#ifndef JSONTOXML_TRACE_LEVEL
+#define JSONTOXML_TRACE_LEVEL 0
+#endif
+
+namespace jsontoxml {
+
+enum TraceLevel {
+    TRACE_OFF = 0,
+    TRACE_INFO = 1,   // stage results: scan/parse accepted or rejected, table size
+    TRACE_DEBUG = 2,  // parsing table entries
+    TRACE_STEP = 3    // every scanned token and every LL(1) step
+};
+
+enum TraceEvent : uint16_t {
+    EV_SCAN_ACCEPTED,
+    EV_SCAN_ERROR,
+    EV_TOKEN,
+    EV_TABLE_ENTRY,
+    EV_TABLE_BUILT,
+    EV_START_SYMBOL,
+    EV_PARSE_STEP,
+    EV_RULE_MATCH,
+    EV_RULE_MISSING,
+    EV_PARSE_ACCEPTED,
+    EV_PARSE_REJECTED
+};
+
+// Fixed-size binary record; strings longer than the slots are truncated.
+struct TraceRecord {
+    uint64_t time_ns;
+    uint16_t event;
+    uint8_t level;
+    uint8_t reserved;
+    uint32_t number;
+    char a[24];
+    char b[24];
+};
+
+// Runtime level, at most JSONTOXML_TRACE_LEVEL. Defaults to TRACE_OFF.
+extern int traceLevel;
+
+// Appends to the in-memory ring (the oldest records are overwritten once it is full).
+void traceEvent(int level, TraceEvent event, std::string_view a, std::string_view b, uint32_t number);
+// Writes the ring, oldest first, to `filename`. Returns the number of records written.
+size_t dumpTrace(const std::string& filename);
+// Prints a dumped trace file as text.
+bool decodeTrace(const std::string& filename, std::ostream& out);
+
+}
+
+#if JSONTOXML_TRACE_LEVEL > 0
+#define JTX_TRACE(level, event, a, b, number) \
+    do { \
+        if ((level) <= JSONTOXML_TRACE_LEVEL && (level) <= ::jsontoxml::traceLevel) \
+            ::jsontoxml::traceEvent((level), (event), (a), (b), (number)); \
+    } while (0)
+#else
+#define JTX_TRACE(level, event, a, b, number) do { } while (0)
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+#include "xml_index.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "result_cache.h"
+using namespace std;
+
+namespace jsontoxml {
+
+static const char INDEX_MAGIC[4] = {'J', 'T', 'X', 'I'};
+static const uint32_t INDEX_VERSION = 1;
+static const size_t HEADER_SIZE = 4 + 4 + 8 + 8 + 8;
+static const size_t SLOT_SIZE = 32;
+static const uint64_t EMPTY_SLOT = ~0ULL;
+
+static void putLe(string& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out += char((v >> (8 * i)) & 0xff);
+}
+
+static uint64_t getLe(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= uint64_t((unsigned char)p[i]) << (8 * i);
+    return v;
+}
+
+static uint64_t pathHash(string_view path) {
+    return hashBytes(path.data(), path.size()).lo;
+}
+
+void XmlIndex::push(uint64_t offset) {
+    marks.push_back(path.size());
+    starts.push_back(offset);
+}
+
+void XmlIndex::enter_root(uint64_t offset, size_t) {
+    path = "$";
+    marks.clear();
+    starts.clear();
+    push(offset);
+}
+
+void XmlIndex::enter_key(string_view key, uint64_t offset, size_t) {
+    push(offset);
+    path += '.';
+    path += key;
+}
+
+void XmlIndex::enter_index(size_t index, uint64_t offset, size_t) {
+    push(offset);
+    path += '[';
+    path += to_string(index);
+    path += ']';
+}
+
+void XmlIndex::leave(uint64_t offset, size_t) {
+    if (marks.empty()) return;
+    // the root is depth 0
+    if (marks.size() - 1 <= max_depth) {
+        Entry e;
+        e.path_offset = pool.size();
+        e.path_length = path.size();
+        e.offset = starts.back();
+        e.length = offset - starts.back();
+        pool += path;
+        entries.push_back(e);
+    }
+    path.resize(marks.back());
+    marks.pop_back();
+    starts.pop_back();
+}
+
+void XmlIndex::clear() {
+    path.clear();
+    marks.clear();
+    starts.clear();
+    pool.clear();
+    entries.clear();
+}
+
+bool XmlIndex::write(const string& filename, string& error) const {
+    uint64_t slots = 16;
+    while (slots < entries.size() + entries.size() / 2) slots *= 2;
+
+    string table(slots * SLOT_SIZE, '\0');
+    for (uint64_t i = 0; i < slots; i++) {
+        memset(&table[i * SLOT_SIZE + 24], 0xff, 8);
+    }
+    string poolOut;
+    for (const Entry& e : entries) {
+        string_view p(pool.data() + e.path_offset, e.path_length);
+        uint64_t h = pathHash(p);
+        uint64_t slot = h & (slots - 1);
+        // a later entry for the same path (duplicate keys) replaces the earlier one
+        while (getLe(&table[slot * SLOT_SIZE + 24], 8) != EMPTY_SLOT) {
+            uint64_t at = getLe(&table[slot * SLOT_SIZE + 24], 8);
+            if (getLe(&table[slot * SLOT_SIZE], 8) == h &&
+                string_view(poolOut.data() + at + 4, getLe(poolOut.data() + at, 4)) == p) break;
+            slot = (slot + 1) & (slots - 1);
+        }
+        string s;
+        putLe(s, h, 8);
+        putLe(s, e.offset, 8);
+        putLe(s, e.length, 8);
+        putLe(s, poolOut.size(), 8);
+        table.replace(slot * SLOT_SIZE, SLOT_SIZE, s);
+        putLe(poolOut, p.size(), 4);
+        poolOut += p;
+    }
+
+    string header(INDEX_MAGIC, 4);
+    putLe(header, INDEX_VERSION, 4);
+    putLe(header, entries.size(), 8);
+    putLe(header, slots, 8);
+    putLe(header, HEADER_SIZE + table.size(), 8);
+
+    ofstream out(filename, ios::binary);
+    out << header << table << poolOut;
+    if (!out) {
+        error = "Error: Cannot write index " + filename;
+        return false;
+    }
+    return true;
+}
+
+bool lookupIndex(const string& filename, string_view path,
+                 uint64_t& offset, uint64_t& length, string& error) {
+    ifstream in(filename, ios::binary);
+    char header[HEADER_SIZE];
+    if (!in.read(header, HEADER_SIZE) || memcmp(header, INDEX_MAGIC, 4) != 0 ||
+        getLe(header + 4, 4) != INDEX_VERSION) {
+        error = "Error: " + filename + " is not an XML index";
+        return false;
+    }
+    uint64_t slots = getLe(header + 16, 8);
+    uint64_t poolOffset = getLe(header + 24, 8);
+    uint64_t h = pathHash(path);
+
+    for (uint64_t probe = 0, slot = h & (slots - 1); probe < slots; probe++, slot = (slot + 1) & (slots - 1)) {
+        char s[SLOT_SIZE];
+        if (!in.seekg(HEADER_SIZE + slot * SLOT_SIZE) || !in.read(s, SLOT_SIZE)) break;
+        uint64_t at = getLe(s + 24, 8);
+        if (at == EMPTY_SLOT) break;
+        if (getLe(s, 8) != h) continue;
+        char lenBytes[4];
+        if (!in.seekg(poolOffset + at) || !in.read(lenBytes, 4)) break;
+        string stored(getLe(lenBytes, 4), '\0');
+        if (!in.read(&stored[0], stored.size())) break;
+        if (stored == path) {
+            offset = getLe(s + 8, 8);
+            length = getLe(s + 16, 8);
+            return true;
+        }
+    }
+    error = "Error: Path '" + string(path) + "' is not in " + filename;
+    return false;
+}
+
+}
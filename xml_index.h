@@ -0,0 +1,62 @@
+#ifndef JSONTOXML_XML_INDEX_H
+#define JSONTOXML_XML_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "converter.h"
+
+namespace jsontoxml {
+
+// Records where each JSON value ended up in the generated XML, keyed by its
+// path: "$", "$.orders", "$.orders[3]", "$.orders[3].id". Keys are appended
+// verbatim. Attached to an XmlOutput, it is told the output offsets as the
+// converter writes; values deeper than `max_depth` path components are not recorded.
+//
+// write() produces a sidecar file holding an open-addressed hash table, so
+// lookupIndex() finds a path with a few reads regardless of the XML's size:
+//
+//   header  "JTXI", u32 version, u64 entries, u64 slots, u64 pool offset
+//   slots   u64 path hash, u64 xml offset, u64 xml length, u64 path offset
+//   pool    u32 length + bytes for every path
+//
+// All integers are little-endian. Empty slots have a path offset of ~0.
+class XmlIndex : public ConvertObserver {
+public:
+    explicit XmlIndex(size_t max_depth = 2) : max_depth(max_depth) {}
+
+    void enter_root(uint64_t offset, size_t json_offset) override;
+    void enter_key(std::string_view key, uint64_t offset, size_t json_offset) override;
+    void enter_index(size_t index, uint64_t offset, size_t json_offset) override;
+    void leave(uint64_t offset, size_t json_offset) override;
+
+    void clear();
+    size_t size() const { return entries.size(); }
+    bool write(const std::string& filename, std::string& error) const;
+
+private:
+    void push(uint64_t offset);
+
+    struct Entry {
+        uint64_t path_offset; // into pool
+        uint32_t path_length;
+        uint64_t offset;
+        uint64_t length;
+    };
+    size_t max_depth;
+    std::string path;
+    std::vector<size_t> marks;     // path length before each open component
+    std::vector<uint64_t> starts;  // output offset of each open component
+    std::string pool;
+    std::vector<Entry> entries;
+};
+
+// Looks `path` up in an index written by XmlIndex::write().
+bool lookupIndex(const std::string& filename, std::string_view path,
+                 uint64_t& offset, uint64_t& length, std::string& error);
+
+}
+
+#endif